@@ -0,0 +1,576 @@
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "../inference/inference.hpp"
+#include "aot.hpp"
+
+namespace execution {
+
+namespace {
+
+using StackTypes = std::vector<StaticType>;
+
+bool IsNumber(StaticType type) {
+	return type == Int || type == Real || type == Logic;
+}
+
+const char* RuntimeOp(OperationType operation) {
+	switch (operation) {
+		case Lexeme::Add:
+			return "runtime::Add";
+		case Lexeme::Sub:
+			return "runtime::Sub";
+		case Lexeme::Mul:
+			return "runtime::Mul";
+		case Lexeme::Div:
+			return "runtime::Div";
+		case Lexeme::Mod:
+			return "runtime::Mod";
+		case Lexeme::Less:
+			return "runtime::Less";
+		case Lexeme::LessEq:
+			return "runtime::LessEq";
+		case Lexeme::Greater:
+			return "runtime::Greater";
+		case Lexeme::GreaterEq:
+			return "runtime::GreaterEq";
+		case Lexeme::Equal:
+			return "runtime::Equal";
+		case Lexeme::NotEqual:
+			return "runtime::NotEqual";
+		case Lexeme::And:
+			return "runtime::And";
+		default:
+			return "runtime::Or";
+	}
+}
+
+const char* CppOperator(OperationType operation) {
+	switch (operation) {
+		case Lexeme::Add:
+			return "+";
+		case Lexeme::Sub:
+			return "-";
+		case Lexeme::Mul:
+			return "*";
+		case Lexeme::Div:
+			return "/";
+		case Lexeme::Less:
+			return "<";
+		case Lexeme::LessEq:
+			return "<=";
+		case Lexeme::Greater:
+			return ">";
+		case Lexeme::GreaterEq:
+			return ">=";
+		case Lexeme::Equal:
+			return "==";
+		default:
+			return "!=";
+	}
+}
+
+const char* CppType(StaticType type) {
+	switch (type) {
+		case Str:
+			return "std::string";
+		case Int:
+			return "int";
+		case Real:
+			return "double";
+		case Logic:
+			return "bool";
+		default:
+			return "runtime::Value";
+	}
+}
+
+const char* RuntimeType(StaticType type) {
+	static const char* const kNames[] = {"runtime::Str", "runtime::Int", "runtime::Real", "runtime::Logic"};
+	return kNames[type];
+}
+
+std::string QuoteString(const std::string& str) {
+	std::string result = "\"";
+	for (unsigned char c : str) {
+		if (c == '"' || c == '\\') {
+			result += '\\';
+			result += c;
+		}
+		else if (c < 0x20 || c >= 0x7F) {
+			char octal[5];
+			std::snprintf(octal, sizeof(octal), "\\%03o", c);
+			result += octal;
+		}
+		else {
+			result += c;
+		}
+	}
+	return result + "\"";
+}
+
+std::string Literal(const PolymorphicValue& value) {
+	switch (value.GetType()) {
+		case Str:
+			return "std::string(" + QuoteString(value.GetString()) + ")";
+		case Int:
+			if (int(value) == std::numeric_limits<int>::min()) {
+				return "(-2147483647 - 1)";
+			}
+			return std::to_string(int(value));
+		case Logic:
+			return bool(value) ? "true" : "false";
+		case Real: {
+			const double real = double(value);
+			if (std::isnan(real)) {
+				return "std::numeric_limits<double>::quiet_NaN()";
+			}
+			if (std::isinf(real)) {
+				return real > 0 ? "std::numeric_limits<double>::infinity()" : "-std::numeric_limits<double>::infinity()";
+			}
+			// Hexadecimal keeps every bit of the double
+			char buffer[64];
+			std::snprintf(buffer, sizeof(buffer), "%a", real);
+			return buffer;
+		}
+	}
+	return "";
+}
+
+class CppEmitter {
+  public:
+	CppEmitter(const Program& program, const std::string& source);
+
+	std::string Emit();
+
+  private:
+	const Program& program_;
+	const std::string& source_;
+	std::vector<StaticType> variable_types_;
+	// Stack types before each instruction; empty for unreached ones
+	std::vector<StackTypes> states_;
+	std::vector<bool> reached_;
+	std::vector<bool> targets_;
+	// Stack locals in use, by depth and type
+	std::set<std::pair<std::size_t, StaticType>> locals_;
+	std::ostringstream code_;
+
+	// Applies the instruction to the stack types; false when control never leaves it
+	bool Transfer(OperationIndex index, StackTypes& stack);
+	bool Merge(OperationIndex index, const StackTypes& stack);
+	void Infer();
+
+	std::string Local(std::size_t depth, StaticType type);
+	std::string Variable(VariableSlot slot) const;
+	std::string Where(OperationIndex index) const;
+	// Boxes the stack entries the target keeps dynamically
+	void Coerce(const StackTypes& from, OperationIndex target, const char* indent);
+
+	void Translate(OperationIndex index);
+	std::string Binary(OperationType operation, const std::string& op1, StaticType type1,
+						const std::string& op2, StaticType type2, OperationIndex index);
+};
+
+std::string Number(const std::string& value, StaticType type) {
+	return type == Logic ? "int(" + value + ")" : value;
+}
+
+std::string Box(const std::string& value, StaticType type) {
+	return type == kAnyType ? value : "runtime::Value(" + value + ")";
+}
+
+std::string Truth(const std::string& value, StaticType type) {
+	switch (type) {
+		case Str:
+			return "!" + value + ".empty()";
+		case Int:
+		case Real:
+			return "(" + value + " != 0)";
+		case Logic:
+			return value;
+		default:
+			return "runtime::Truth(" + value + ")";
+	}
+}
+
+std::string TypeOf(const std::string& value, StaticType type) {
+	return type == kAnyType ? value + ".type" : RuntimeType(type);
+}
+
+CppEmitter::CppEmitter(const Program& program, const std::string& source): program_(program), source_(source),
+	variable_types_(program.variables.size(), kNoType), states_(program.code.size() + 1),
+	reached_(program.code.size() + 1, false), targets_(program.code.size() + 1, false) {}
+
+bool CppEmitter::Transfer(OperationIndex index, StackTypes& stack) {
+	const Instruction& instruction = program_.code[index];
+	auto pop = [&stack]() {
+		const StaticType type = stack.back();
+		stack.pop_back();
+		return type;
+	};
+	switch (instruction.opcode) {
+		case Opcode::PushConst:
+			stack.push_back(program_.constants[instruction.operand].GetType());
+			return true;
+		case Opcode::Load:
+			// A variable that is never assigned always raises NameError
+			if (variable_types_[instruction.operand] == kNoType) {
+				return false;
+			}
+			stack.push_back(variable_types_[instruction.operand]);
+			return true;
+		case Opcode::Store:
+			variable_types_[instruction.operand] = Join(variable_types_[instruction.operand], pop());
+			return true;
+		case Opcode::AddOne:
+			pop();
+			variable_types_[instruction.operand] = Join(variable_types_[instruction.operand], Int);
+			return true;
+		case Opcode::Go:
+			return true;
+		case Opcode::If:
+			pop();
+			return true;
+		case Opcode::Binary:
+		case Opcode::TypedBinary: {
+			const StaticType type2 = pop();
+			const StaticType type1 = pop();
+			stack.push_back(BinaryType(OperationType(instruction.aux), type1, type2));
+			return true;
+		}
+		case Opcode::UnaryMinus: {
+			const StaticType type = pop();
+			stack.push_back(type == Int || type == Logic ? Int : type == Real ? Real : kAnyType);
+			return true;
+		}
+		case Opcode::Not:
+			pop();
+			stack.push_back(Logic);
+			return true;
+		case Opcode::GetRange:
+			if (stack.size() == 1) {
+				stack.insert(stack.begin(), Int);
+			}
+			return true;
+		case Opcode::Cast:
+			pop();
+			stack.push_back(CastType(OperationType(instruction.aux)));
+			return true;
+		case Opcode::Print:
+			stack.resize(stack.size() - instruction.operand);
+			return true;
+		default:
+			throw std::logic_error("--emit-cpp takes unfused bytecode");
+	}
+}
+
+bool CppEmitter::Merge(OperationIndex index, const StackTypes& stack) {
+	if (!reached_[index]) {
+		reached_[index] = true;
+		states_[index] = stack;
+		return true;
+	}
+	bool changed = false;
+	for (std::size_t depth = 0; depth < stack.size(); ++depth) {
+		const StaticType joined = Join(states_[index][depth], stack[depth]);
+		changed = changed || joined != states_[index][depth];
+		states_[index][depth] = joined;
+	}
+	return changed;
+}
+
+void CppEmitter::Infer() {
+	// StackDepths rejects programs whose paths meet with different depths
+	StackDepths(program_);
+	reached_[0] = true;
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (OperationIndex index = 0; index < program_.code.size(); ++index) {
+			if (!reached_[index]) {
+				continue;
+			}
+			const std::vector<StaticType> variables = variable_types_;
+			StackTypes stack = states_[index];
+			if (!Transfer(index, stack)) {
+				continue;
+			}
+			changed = changed || variables != variable_types_;
+			const Instruction& instruction = program_.code[index];
+			if (IsJump(instruction.opcode)) {
+				changed = Merge(instruction.operand, stack) || changed;
+			}
+			if (instruction.opcode != Opcode::Go) {
+				changed = Merge(index + 1, stack) || changed;
+			}
+		}
+	}
+}
+
+std::string CppEmitter::Local(std::size_t depth, StaticType type) {
+	static const char* const kSuffixes[] = {"s", "i", "r", "b", "v"};
+	locals_.emplace(depth, type);
+	return "s" + std::to_string(depth) + "_" + kSuffixes[type];
+}
+
+std::string CppEmitter::Variable(VariableSlot slot) const {
+	return "v" + std::to_string(slot);
+}
+
+std::string CppEmitter::Where(OperationIndex index) const {
+	const Location& location = program_.locations[index];
+	return std::to_string(location.line) + ", " + std::to_string(location.pos);
+}
+
+void CppEmitter::Coerce(const StackTypes& from, OperationIndex target, const char* indent) {
+	for (std::size_t depth = 0; depth < from.size(); ++depth) {
+		if (from[depth] != states_[target][depth]) {
+			code_ << indent << Local(depth, kAnyType) << " = runtime::Value(" << Local(depth, from[depth]) << ");\n";
+		}
+	}
+}
+
+std::string CppEmitter::Binary(OperationType operation, const std::string& op1, StaticType type1,
+						const std::string& op2, StaticType type2, OperationIndex index) {
+	const StaticType result = BinaryType(operation, type1, type2);
+	if (operation == Lexeme::And || operation == Lexeme::Or) {
+		return "(" + Truth(op1, type1) + (operation == Lexeme::And ? " && " : " || ") + Truth(op2, type2) + ")";
+	}
+	if (result == kAnyType) {
+		return "runtime::Binary(" + std::string(RuntimeOp(operation)) + ", " +
+			QuoteString(Lexeme::TypeToString(operation)) + ", " + Box(op1, type1) + ", " + Box(op2, type2) + ", " +
+			Where(index) + ")";
+	}
+	if (IsNumber(type1) && IsNumber(type2)) {
+		const std::string a = Number(op1, type1);
+		const std::string b = Number(op2, type2);
+		if (result == Int) {
+			switch (operation) {
+				case Lexeme::Add:
+					return "runtime::AddInt(" + a + ", " + b + ")";
+				case Lexeme::Sub:
+					return "runtime::SubInt(" + a + ", " + b + ")";
+				case Lexeme::Mul:
+					return "runtime::MulInt(" + a + ", " + b + ")";
+				case Lexeme::Div:
+					return "runtime::DivInt(" + a + ", " + b + ")";
+				default:
+					return "runtime::ModInt(" + a + ", " + b + ")";
+			}
+		}
+		return "(" + a + " " + CppOperator(operation) + " " + b + ")";
+	}
+	if (type1 == Str && type2 == Str) {
+		return "(" + op1 + " " + CppOperator(operation) + " " + op2 + ")";
+	}
+	if (operation == Lexeme::Mul) {
+		return type1 == Str ? "runtime::Repeat(" + op1 + ", " + op2 + ")" : "runtime::Repeat(" + op2 + ", " + op1 + ")";
+	}
+	// A string is never equal to a number or a bool
+	return "false";
+}
+
+void CppEmitter::Translate(OperationIndex index) {
+	const Instruction& instruction = program_.code[index];
+	StackTypes stack = states_[index];
+	const std::size_t depth = stack.size();
+	// The operand n entries below the top
+	auto operand = [&](std::size_t below) {
+		return Local(depth - 1 - below, stack[depth - 1 - below]);
+	};
+
+	switch (instruction.opcode) {
+		case Opcode::PushConst: {
+			const PolymorphicValue& constant = program_.constants[instruction.operand];
+			code_ << "\t" << Local(depth, constant.GetType()) << " = " << Literal(constant) << ";\n";
+			break;
+		}
+		case Opcode::Load: {
+			const VariableSlot slot = instruction.operand;
+			const std::string name = QuoteString(program_.variables[slot]);
+			if (variable_types_[slot] == kNoType) {
+				code_ << "\truntime::NameError(" << name << ", " << Where(index) << ");\n";
+				break;
+			}
+			code_ << "\tif (!" << Variable(slot) << "_set) runtime::NameError(" << name << ", " << Where(index) << ");\n";
+			code_ << "\t" << Local(depth, variable_types_[slot]) << " = " << Variable(slot) << ";\n";
+			break;
+		}
+		case Opcode::Store: {
+			const VariableSlot slot = instruction.operand;
+			code_ << "\t" << Variable(slot) << " = " << operand(0) << ";\n";
+			code_ << "\t" << Variable(slot) << "_set = true;\n";
+			break;
+		}
+		case Opcode::AddOne: {
+			const VariableSlot slot = instruction.operand;
+			const StaticType type = stack.back();
+			std::string value = operand(0);
+			if (type == Logic) {
+				value = "int(" + value + ")";
+			}
+			else if (type != Int) {
+				value = "runtime::ToInt(" + Box(value, type) + ")";
+			}
+			code_ << "\t" << Variable(slot) << " = runtime::AddInt(" << value << ", 1);\n";
+			code_ << "\t" << Variable(slot) << "_set = true;\n";
+			break;
+		}
+		case Opcode::Go:
+			Coerce(stack, instruction.operand, "\t");
+			code_ << "\tgoto L" << instruction.operand << ";\n";
+			break;
+		case Opcode::If: {
+			const std::string condition = Truth(operand(0), stack.back());
+			stack.pop_back();
+			code_ << "\tif (!" << condition << ") {\n";
+			Coerce(stack, instruction.operand, "\t\t");
+			code_ << "\t\tgoto L" << instruction.operand << ";\n\t}\n";
+			break;
+		}
+		case Opcode::Binary:
+		case Opcode::TypedBinary: {
+			const OperationType operation = OperationType(instruction.aux);
+			const StaticType result = BinaryType(operation, stack[depth - 2], stack[depth - 1]);
+			code_ << "\t" << Local(depth - 2, result) << " = " <<
+				Binary(operation, operand(1), stack[depth - 2], operand(0), stack[depth - 1], index) << ";\n";
+			break;
+		}
+		case Opcode::UnaryMinus: {
+			const StaticType type = stack.back();
+			std::string value;
+			switch (type) {
+				case Int:
+					value = "runtime::NegInt(" + operand(0) + ")";
+					break;
+				case Logic:
+					value = "runtime::NegInt(int(" + operand(0) + "))";
+					break;
+				case Real:
+					value = "(-" + operand(0) + ")";
+					break;
+				default:
+					value = "runtime::Negate(" + Box(operand(0), type) + ", " + Where(index) + ")";
+					break;
+			}
+			const StaticType result = type == Logic ? Int : type == Str ? kAnyType : type;
+			code_ << "\t" << Local(depth - 1, result) << " = " << value << ";\n";
+			break;
+		}
+		case Opcode::Not:
+			code_ << "\t" << Local(depth - 1, Logic) << " = !" << Truth(operand(0), stack.back()) << ";\n";
+			break;
+		case Opcode::GetRange:
+			if (depth == 1) {
+				const StaticType type = stack[0];
+				if (type != Int && type != Logic) {
+					code_ << "\truntime::CheckRange(" << TypeOf(operand(0), type) << ", " << Where(index) << ");\n";
+				}
+				// range(stop) starts at 0
+				code_ << "\t" << Local(1, type) << " = " << Local(0, type) << ";\n";
+				code_ << "\t" << Local(0, Int) << " = 0;\n";
+			}
+			else if (!((stack[depth - 2] == Int || stack[depth - 2] == Logic) &&
+					(stack[depth - 1] == Int || stack[depth - 1] == Logic))) {
+				code_ << "\truntime::CheckRange(" << TypeOf(operand(1), stack[depth - 2]) << ", " <<
+					TypeOf(operand(0), stack[depth - 1]) << ", " << Where(index) << ");\n";
+			}
+			break;
+		case Opcode::Cast: {
+			const StaticType type = stack.back();
+			const std::string value = operand(0);
+			std::string result;
+			switch (instruction.aux) {
+				case Lexeme::Bool:
+					result = Truth(value, type);
+					break;
+				case Lexeme::Int:
+					result = type == Int ? value : type == Str || type == kAnyType ?
+						"runtime::IntCast(" + value + ", " + Where(index) + ")" : "int(" + value + ")";
+					break;
+				case Lexeme::Float:
+					result = type == Real ? value : type == Str || type == kAnyType ?
+						"runtime::FloatCast(" + value + ", " + Where(index) + ")" : "double(" + value + ")";
+					break;
+				default:
+					result = type == Str ? value : "runtime::StrCast(" + value + ")";
+					break;
+			}
+			code_ << "\t" << Local(depth - 1, CastType(OperationType(instruction.aux))) << " = " << result << ";\n";
+			break;
+		}
+		case Opcode::Print:
+			code_ << "\truntime::Print(";
+			for (std::size_t below = instruction.operand; below-- > 0;) {
+				code_ << operand(below) << (below > 0 ? ", " : ");\n");
+			}
+			break;
+		default:
+			throw std::logic_error("--emit-cpp takes unfused bytecode");
+	}
+
+	StackTypes after = states_[index];
+	if (Transfer(index, after) && instruction.opcode != Opcode::Go) {
+		Coerce(after, index + 1, "\t");
+	}
+}
+
+std::string CppEmitter::Emit() {
+	Infer();
+	for (OperationIndex index = 0; index < program_.code.size(); ++index) {
+		if (reached_[index] && IsJump(program_.code[index].opcode)) {
+			targets_[program_.code[index].operand] = true;
+		}
+	}
+	for (OperationIndex index = 0; index < program_.code.size(); ++index) {
+		if (targets_[index]) {
+			code_ << "L" << index << ":\n";
+		}
+		if (reached_[index]) {
+			Translate(index);
+		}
+	}
+	if (targets_[program_.code.size()]) {
+		code_ << "L" << program_.code.size() << ":;\n";
+	}
+
+	std::ostringstream out;
+	out << "// Generated from " << source_ << " by python --emit-cpp. Build with\n"
+		<< "// clang++ -std=c++17 -O2 -I<interpreter> this.cpp <interpreter>/output/output.cpp "
+		<< "<interpreter>/format/format.cpp\n\n"
+		<< "#include \"aot/runtime.hpp\"\n\n"
+		<< "static void Run() {\n";
+	for (VariableSlot slot = 0; slot < variable_types_.size(); ++slot) {
+		if (variable_types_[slot] == kNoType) {
+			continue;
+		}
+		out << "\t" << CppType(variable_types_[slot]) << " " << Variable(slot) << "{};  // "
+			<< program_.variables[slot] << "\n"
+			<< "\tbool " << Variable(slot) << "_set = false;\n";
+	}
+	for (const auto& local : locals_) {
+		out << "\t" << CppType(local.second) << " " << Local(local.first, local.second) << "{};\n";
+	}
+	out << "\n" << code_.str() << "}\n\n"
+		<< "int main() {\n"
+		<< "\treturn runtime::Main(Run);\n"
+		<< "}\n";
+	return out.str();
+}
+
+} // namespace
+
+std::string EmitCpp(const Program& program, const std::string& source) {
+	return CppEmitter(program, source).Emit();
+}
+
+} // namespace execution
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+
+namespace execution {
+
+// Translates unfused bytecode into a standalone C++17 program built on
+// aot/runtime.hpp. Stack entries and variables whose type is the same on every
+// path become native ints, doubles, bools and strings; the rest stay dynamic.
+// Throws std::logic_error on superinstructions.
+std::string EmitCpp(const Program& program, const std::string& source);
+
+} // namespace execution
@@ -0,0 +1,359 @@
+#pragma once
+
+// Runtime of the C++ that --emit-cpp generates. Values whose type is known when
+// the script is translated are plain ints, doubles, bools and strings; the rest
+// are runtime::Value, which follows the interpreter's rules and error messages.
+// Link with output/output.cpp and format/format.cpp.
+
+#include <csignal>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <unistd.h>
+
+#include "../output/output.hpp"
+#include "../format/format.hpp"
+
+namespace runtime {
+
+// Same order as execution::ValueType
+enum Type { Str, Int, Real, Logic };
+
+enum Op { Add, Sub, Mul, Div, Mod, Less, LessEq, Greater, GreaterEq, Equal, NotEqual, And, Or };
+
+inline const char* TypeName(Type type) {
+	static const char* const kNames[] = {"string", "int", "double", "bool"};
+	return kNames[type];
+}
+
+inline std::string Where(int line, int pos) {
+	return "line " + std::to_string(line) + ":" + std::to_string(pos) + ": ";
+}
+
+struct Value {
+	Type type = Int;
+	int integral = 0;
+	double real = 0.0;
+	bool logic = false;
+	std::string str;
+
+	Value() = default;
+	Value(int value): type(Int), integral(value) {}
+	Value(double value): type(Real), real(value) {}
+	Value(bool value): type(Logic), logic(value) {}
+	Value(const std::string& value): type(Str), str(value) {}
+	Value(const char* value): type(Str), str(value) {}
+};
+
+[[noreturn]] inline void NameError(const char* name, int line, int pos) {
+	throw std::runtime_error(Where(line, pos) + "NameError: name '" + name + "' is not defined");
+}
+
+[[noreturn]] inline void TypeError(const char* op, Type type1, Type type2, int line, int pos) {
+	throw std::runtime_error(Where(line, pos) + "TypeError: unsupported operand type(s) for " + op + ": " +
+		TypeName(type1) + " and " + TypeName(type2));
+}
+
+// Ints wrap around like the machine arithmetic of the interpreter
+inline int AddInt(int a, int b) { return int(std::uint32_t(a) + std::uint32_t(b)); }
+inline int SubInt(int a, int b) { return int(std::uint32_t(a) - std::uint32_t(b)); }
+inline int MulInt(int a, int b) { return int(std::uint32_t(a) * std::uint32_t(b)); }
+inline int NegInt(int a) { return int(0u - std::uint32_t(a)); }
+
+// The interpreter dies of SIGFPE here, and so does the native program
+inline void CheckDivisor(int a, int b) {
+	if (b == 0 || (b == -1 && a == INT32_MIN)) {
+		std::raise(SIGFPE);
+	}
+}
+
+inline int DivInt(int a, int b) {
+	CheckDivisor(a, b);
+	return a / b;
+}
+
+inline int ModInt(int a, int b) {
+	CheckDivisor(a, b);
+	return a % b;
+}
+
+inline std::string Repeat(const std::string& str, int times) {
+	std::string result;
+	for (int i = 0; i < times; ++i) {
+		result += str;
+	}
+	return result;
+}
+
+inline bool Truth(const Value& value) {
+	switch (value.type) {
+		case Str:
+			return !value.str.empty();
+		case Int:
+			return value.integral != 0;
+		case Real:
+			return value.real != 0;
+		case Logic:
+			return value.logic;
+	}
+	return false;
+}
+
+// int() of a value as the interpreter reads it in for loops
+inline int ToInt(const Value& value) {
+	switch (value.type) {
+		case Int:
+			return value.integral;
+		case Logic:
+			return value.logic ? 1 : 0;
+		case Str:
+			throw std::logic_error("type mismatch expected string != actual int");
+		default:
+			throw std::logic_error("type mismatch expected double != actual int");
+	}
+}
+
+inline double ToReal(const Value& value) {
+	return value.type == Real ? value.real : double(ToInt(value));
+}
+
+template<typename T>
+Value Arithmetic(Op op, T a, T b) {
+	switch (op) {
+		case Less:
+			return a < b;
+		case LessEq:
+			return a <= b;
+		case Greater:
+			return a > b;
+		case GreaterEq:
+			return a >= b;
+		case Equal:
+			return a == b;
+		case NotEqual:
+			return a != b;
+		default:
+			break;
+	}
+	if constexpr (std::is_same_v<T, int>) {
+		switch (op) {
+			case Add:
+				return AddInt(a, b);
+			case Sub:
+				return SubInt(a, b);
+			case Mul:
+				return MulInt(a, b);
+			case Div:
+				return DivInt(a, b);
+			default:
+				return ModInt(a, b);
+		}
+	}
+	else {
+		switch (op) {
+			case Add:
+				return a + b;
+			case Sub:
+				return a - b;
+			case Mul:
+				return a * b;
+			default:
+				return a / b;
+		}
+	}
+}
+
+// A binary operation on values whose types were not known statically
+inline Value Binary(Op op, const char* name, const Value& a, const Value& b, int line, int pos) {
+	if (op == And) {
+		return Truth(a) && Truth(b);
+	}
+	if (op == Or) {
+		return Truth(a) || Truth(b);
+	}
+	if (a.type != Str && b.type != Str) {
+		if (a.type == Real || b.type == Real) {
+			if (op == Mod) {
+				TypeError(name, a.type, b.type, line, pos);
+			}
+			return Arithmetic(op, ToReal(a), ToReal(b));
+		}
+		return Arithmetic(op, ToInt(a), ToInt(b));
+	}
+	if (a.type == Str && b.type == Str) {
+		switch (op) {
+			case Add:
+				return a.str + b.str;
+			case Less:
+				return a.str < b.str;
+			case LessEq:
+				return a.str <= b.str;
+			case Greater:
+				return a.str > b.str;
+			case GreaterEq:
+				return a.str >= b.str;
+			case Equal:
+				return a.str == b.str;
+			case NotEqual:
+				return a.str != b.str;
+			default:
+				TypeError(name, a.type, b.type, line, pos);
+		}
+	}
+	if (op == Mul && a.type == Str && b.type == Int) {
+		return Repeat(a.str, b.integral);
+	}
+	if (op == Mul && a.type == Int && b.type == Str) {
+		return Repeat(b.str, a.integral);
+	}
+	if (op == Equal) {
+		return false;
+	}
+	TypeError(name, a.type, b.type, line, pos);
+}
+
+inline Value Negate(const Value& value, int line, int pos) {
+	switch (value.type) {
+		case Real:
+			return -value.real;
+		case Str:
+			throw std::runtime_error(Where(line, pos) + "TypeError: unsupported operand type(s) for unary -: string");
+		default:
+			return NegInt(ToInt(value));
+	}
+}
+
+inline void CheckRange(Type type, int line, int pos) {
+	if (type != Int && type != Logic) {
+		throw std::runtime_error(Where(line, pos) + "TypeError: unsupported operand type(s) for range: " +
+			TypeName(type));
+	}
+}
+
+inline void CheckRange(Type type1, Type type2, int line, int pos) {
+	if ((type1 != Int && type1 != Logic) || (type2 != Int && type2 != Logic)) {
+		throw std::runtime_error(Where(line, pos) + "TypeError: unsupported operand type(s) for range: " +
+			TypeName(type1) + " and " + TypeName(type2));
+	}
+}
+
+inline int IntCast(const std::string& str, int line, int pos) {
+	if (str == "True" || str == "False") {
+		return str == "True";
+	}
+	int integral = 0;
+	switch (execution::ParseInt(str, integral)) {
+		case execution::ParseStatus::Ok:
+			return integral;
+		case execution::ParseStatus::OutOfRange:
+			throw std::runtime_error(Where(line, pos) + "RangeError: " + str + " is too big for int()");
+		default:
+			throw std::runtime_error(Where(line, pos) + "ValueError: invalid literal for int(): '" + str + "'");
+	}
+}
+
+inline double FloatCast(const std::string& str, int line, int pos) {
+	if (str == "True" || str == "False") {
+		return str == "True" ? 1.0 : 0.0;
+	}
+	double real = 0.0;
+	switch (execution::ParseReal(str, real)) {
+		case execution::ParseStatus::Ok:
+			return real;
+		case execution::ParseStatus::OutOfRange:
+			throw std::runtime_error(Where(line, pos) + "RangeError: " + str + " is too precise for float()");
+		default:
+			throw std::runtime_error(Where(line, pos) + "ValueError: could not convert string to float: '" + str + "'");
+	}
+}
+
+inline int IntCast(const Value& value, int line, int pos) {
+	switch (value.type) {
+		case Str:
+			return IntCast(value.str, line, pos);
+		case Real:
+			return int(value.real);
+		default:
+			return ToInt(value);
+	}
+}
+
+inline double FloatCast(const Value& value, int line, int pos) {
+	return value.type == Str ? FloatCast(value.str, line, pos) : ToReal(value);
+}
+
+inline std::string StrCast(bool value) { return value ? "True" : "False"; }
+inline std::string StrCast(int value) { return execution::IntToString(value); }
+inline std::string StrCast(double value) { return execution::RealToString(value); }
+inline std::string StrCast(const std::string& value) { return value; }
+
+inline std::string StrCast(const Value& value) {
+	switch (value.type) {
+		case Str:
+			return value.str;
+		case Int:
+			return StrCast(value.integral);
+		case Real:
+			return StrCast(value.real);
+		default:
+			return StrCast(value.logic);
+	}
+}
+
+inline void Write(execution::Output& out, int value) {
+	char buffer[execution::kMaxNumberChars];
+	out.Write(buffer, execution::FormatInt(buffer, value) - buffer);
+}
+
+inline void Write(execution::Output& out, double value) {
+	char buffer[execution::kMaxNumberChars];
+	out.Write(buffer, execution::FormatReal(buffer, value) - buffer);
+}
+
+inline void Write(execution::Output& out, bool value) { out.Write(value ? "True" : "False"); }
+inline void Write(execution::Output& out, const std::string& value) { out.Write(value); }
+
+inline void Write(execution::Output& out, const Value& value) {
+	switch (value.type) {
+		case Str:
+			Write(out, value.str);
+			break;
+		case Int:
+			Write(out, value.integral);
+			break;
+		case Real:
+			Write(out, value.real);
+			break;
+		case Logic:
+			Write(out, value.logic);
+			break;
+	}
+}
+
+template<typename First, typename... Rest>
+void Print(const First& first, const Rest&... rest) {
+	execution::Output& out = execution::Stdout();
+	Write(out, first);
+	((out.Write(' '), Write(out, rest)), ...);
+	out.EndLine();
+}
+
+// Runs the translated script the way the interpreter runs a file
+inline int Main(void (*run)()) {
+	execution::Stdout().SetPolicy(execution::DefaultPolicy(STDOUT_FILENO));
+	execution::FlushOnFatalSignals();
+	try {
+		run();
+	} catch (const std::exception& e) {
+		execution::Stdout().Flush();
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+} // namespace runtime
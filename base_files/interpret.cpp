@@ -1,34 +1,337 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 
+#include <unistd.h>
+
 #include "../parser/parser.hpp"
 #include "../lexer/lexer.hpp"
+#include "../lexer/source.hpp"
+#include "../lexer/scan.hpp"
 #include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "../optimizer/optimizer.hpp"
+#include "../register_vm/register_vm.hpp"
+#include "../jit/jit.hpp"
+#include "../aot/aot.hpp"
+#include "../inference/inference.hpp"
+#include "../output/output.hpp"
+#include "../profile/profile.hpp"
+#include "../profile/sampler.hpp"
+
+#include "interpret.hpp"
+
+Options ParseOptions(int argc, char* argv[]) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		if (arg == "--engine=poliz") {
+			options.engine = Engine::Poliz;
+		}
+		else if (arg == "--engine=bytecode") {
+			options.engine = Engine::Bytecode;
+		}
+		else if (arg == "--engine=register") {
+			options.engine = Engine::Register;
+		}
+		else if (arg == "-O0" || arg == "-O1") {
+			options.optimize = arg[2] - '0';
+		}
+		else if (arg == "--stats") {
+			options.stats = true;
+		}
+		else if (arg == "--unbuffered") {
+			options.unbuffered = true;
+		}
+		else if (arg == "--no-jit") {
+			options.jit = false;
+		}
+		else if (arg == "--emit-cpp") {
+			options.emit_cpp = true;
+		}
+		else if (arg == "--lexer=scalar" || arg == "--lexer=sse2" || arg == "--lexer=avx2") {
+			options.lexer = arg.substr(8);
+		}
+		else if (arg == "--time") {
+			options.time = true;
+		}
+		else if (arg == "--profile") {
+			options.profile = "profile.folded";
+		}
+		else if (arg.rfind("--profile=", 0) == 0 && arg.size() > 10) {
+			options.profile = arg.substr(10);
+		}
+		else if (arg.rfind("--sample-profile=", 0) == 0) {
+			const std::string rate = arg.substr(17);
+			if (rate.empty() || rate.size() > 6 || rate.find_first_not_of("0123456789") != std::string::npos ||
+				std::stoi(rate) == 0) {
+				throw std::invalid_argument("Error: --sample-profile expects a rate from 1 to 999999 Hz");
+			}
+			options.sample_rate = std::stoi(rate);
+		}
+		else if (arg.rfind("--sample-out=", 0) == 0 && arg.size() > 13) {
+			options.sample_out = arg.substr(13);
+		}
+		else if (arg.rfind("-", 0) == 0) {
+			throw std::invalid_argument("Error: unknown option " + arg);
+		}
+		else if (options.file.empty()) {
+			options.file = arg;
+		}
+		else {
+			throw std::invalid_argument("Error: unexpected argument " + arg);
+		}
+	}
+	if (options.file.empty()) {
+		throw std::invalid_argument("Error: expected argument");
+	}
+	if (!options.profile.empty() && options.engine != Engine::Poliz) {
+		throw std::invalid_argument("Error: --profile needs --engine=poliz");
+	}
+	if (options.sample_rate > 0 && (!options.profile.empty() || options.engine == Engine::Register)) {
+		throw std::invalid_argument("Error: --sample-profile needs --engine=poliz or bytecode, without --profile");
+	}
+	if (!options.sample_out.empty() && options.sample_rate == 0) {
+		throw std::invalid_argument("Error: --sample-out needs --sample-profile");
+	}
+	if (options.sample_rate > 0 && options.sample_out.empty()) {
+		options.sample_out = "profile.folded";
+	}
+	return options;
+}
+
+// Binary operation sites quicken themselves in parser.operations as they run
+void RunPoliz(Parser& parser, execution::Context& context) {
+	context.operations = &parser.operations;
+	while (context.operation_index < parser.operations.size()) {
+		context.current_index.store(context.operation_index, std::memory_order_relaxed);
+		const auto& operation = parser.operations[context.operation_index];
+		++context.operation_index;
+		operation->Do(context);
+	}
+}
+
+// Milliseconds since start
+double Elapsed(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A lexer pass on its own, since the parser pulls lexemes as it goes
+double LexTime(const std::string& file) {
+	const SourceFile source(file);
+	const auto start = std::chrono::steady_clock::now();
+	Lexer lexer(source.Data(), source.Size());
+	while (lexer.HasLexeme()) {
+		lexer.TakeLexeme();
+	}
+	return Elapsed(start);
+}
+
+// The report goes to stderr, the collapsed stacks to path
+void WriteProfile(const execution::Profile& profile, const execution::Program& program,
+				const std::string& file, const std::string& path) {
+	execution::Stdout().Flush();
+	profile.WriteReport(program, std::cerr);
+	std::ofstream collapsed(path);
+	profile.WriteCollapsed(program, file, collapsed);
+	if (!collapsed) {
+		std::cerr << "Error: cannot write " << path << std::endl;
+		return;
+	}
+	std::cerr << "profile: wrote " << path << std::endl;
+}
+
+// RunPoliz with a clock read after every operation; the profile is written also when the script raises
+void RunProfiled(Parser& parser, execution::Context& context, const Options& options) {
+	using Clock = std::chrono::steady_clock;
+	context.operations = &parser.operations;
+	const execution::Program program = execution::Compile(parser.operations, parser.variables, parser.constants);
+	execution::Profile profile(program.code.size(), "ns");
+	try {
+		Clock::time_point start = Clock::now();
+		while (context.operation_index < parser.operations.size()) {
+			const execution::OperationIndex index = context.operation_index;
+			++context.operation_index;
+			parser.operations[index]->Do(context);
+			const Clock::time_point end = Clock::now();
+			profile.Record(index, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+			start = end;
+		}
+	} catch (...) {
+		WriteProfile(profile, program, options.file, options.profile);
+		throw;
+	}
+	WriteProfile(profile, program, options.file, options.profile);
+}
+
+// Runs the script under the sampling profiler; the profile is written also when the script raises
+template <typename Run>
+void RunSampled(const execution::Program& program, execution::Context& context, const Options& options, Run run) {
+	execution::Profile profile(program.code.size(), "");
+	execution::Sampler sampler(context, options.sample_rate, profile);
+	auto write = [&]() {
+		sampler.Stop();
+		WriteProfile(profile, program, options.file, options.sample_out);
+		if (sampler.Dropped() > 0) {
+			std::cerr << "profile: dropped " << sampler.Dropped() << " samples" << std::endl;
+		}
+	};
+	try {
+		run();
+	} catch (...) {
+		write();
+		throw;
+	}
+	write();
+}
+
+// Hit rate of every binary operation site that ran
+void ReportInlineCaches(const Parser& parser) {
+	for (const auto& operation : parser.operations) {
+		const execution::ExecuteOperation* site = operation->Site();
+		if (!site) {
+			continue;
+		}
+		const execution::InlineCache& cache = site->Cache();
+		const std::size_t total = cache.hits + cache.misses;
+		if (total == 0) {
+			continue;
+		}
+		std::cerr << "ic: " << site->Describe() << " hits " << cache.hits << " misses " << cache.misses
+			<< " (" << 100 * cache.hits / total << "%)";
+		if (cache.deoptimizations > 0) {
+			std::cerr << " deoptimized " << cache.deoptimizations;
+		}
+		std::cerr << std::endl;
+	}
+}
 
 int Python(int argc, char* argv[]) {
-	if (argc != 2) {
-		std::cerr << "Error: expected argument" << std::endl;
+	Options options;
+	try {
+		options = ParseOptions(argc, argv);
+	} catch (const std::invalid_argument& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	if (!std::filesystem::exists(options.file)) {
+		std::cerr << "Error: file " + options.file + " does not exist" << std::endl;
 		return 1;
 	}
-	if (!std::filesystem::exists(argv[1])) {
-		std::cerr << "Error: file " + std::string(argv[1]) + " does not exist" << std::endl;
+	if (!options.lexer.empty() && !SelectScanKernels(options.lexer)) {
+		std::cerr << "Error: this CPU cannot run the " + options.lexer + " lexer" << std::endl;
 		return 1;
 	}
+	execution::Stdout().SetPolicy(
+		options.unbuffered ? execution::FlushPolicy::Unbuffered : execution::DefaultPolicy(STDOUT_FILENO));
+	execution::FlushOnFatalSignals();
 	try {
-		std::ifstream input(argv[1]);
+		const double lex = options.time ? LexTime(options.file) : 0;
+		auto start = std::chrono::steady_clock::now();
+		const SourceFile source(options.file);
 
 		execution::Context context;
-		Parser parser(input);
+		Parser parser(source.Data(), source.Size());
 		parser.Run();
+		// The parser's own lexing is already counted
+		const double parse = std::max(0.0, Elapsed(start) - lex);
+		if (options.stats) {
+			std::cerr << "lexer: " << ActiveScanKernels().name << " kernels" << std::endl;
+		}
+		start = std::chrono::steady_clock::now();
+		if (options.optimize > 0) {
+			const std::size_t total = parser.operations.size();
+			const std::size_t removed = execution::Optimize(parser.operations, parser.constants);
+			// The C++ compiler does its own fusing
+			const std::size_t fused = options.emit_cpp ? 0 : execution::Fuse(parser.operations, parser.variables);
+			const execution::Specialization types =
+				execution::Specialize(parser.operations, parser.variables, parser.constants);
+			if (options.stats) {
+				std::cerr << "optimizer: removed " << removed << " of " << total << " operations, "
+					<< "fused " << fused << " more into superinstructions" << std::endl;
+				std::cerr << "types: specialized " << types.specialized << " of " << types.binaries
+					<< " binary operations (" << (types.binaries ? 100 * types.specialized / types.binaries : 100)
+					<< "%), resolved " << types.casts << " casts" << std::endl;
+				for (const auto& name : types.names) {
+					std::cerr << "types: " << name.first << " x" << name.second << std::endl;
+				}
+			}
+		}
+		const double optimize = Elapsed(start);
+		if (options.emit_cpp) {
+			std::cout << execution::EmitCpp(
+				execution::Compile(parser.operations, parser.variables, parser.constants), options.file);
+			return 0;
+		}
+		start = std::chrono::steady_clock::now();
+		context.stack.Reserve(parser.max_stack_depth);
+		context.variables.resize(parser.variables.size());
+		context.constants = parser.constants;
+		context.count_caches = options.stats;
 
-		while (context.operation_index < parser.operations.size()) {
-			const auto& operation = parser.operations[context.operation_index];
-			++context.operation_index;
-			operation->Do(context);
+		switch (options.engine) {
+			case Engine::Poliz:
+				if (!options.profile.empty()) {
+					RunProfiled(parser, context, options);
+				}
+				else if (options.sample_rate > 0) {
+					const execution::Program program =
+						execution::Compile(parser.operations, parser.variables, parser.constants);
+					RunSampled(program, context, options, [&]() { RunPoliz(parser, context); });
+				}
+				else {
+					RunPoliz(parser, context);
+				}
+				if (options.stats) {
+					ReportInlineCaches(parser);
+				}
+				break;
+			case Engine::Bytecode: {
+				const execution::Program program = execution::Compile(parser.operations, parser.variables, parser.constants);
+				std::unique_ptr<execution::Jit> jit;
+				if (options.jit) {
+					jit = std::make_unique<execution::Jit>(program);
+				}
+				if (options.sample_rate > 0) {
+					RunSampled(program, context, options, [&]() { execution::Run(program, context, jit.get()); });
+				}
+				else {
+					execution::Run(program, context, jit.get());
+				}
+				if (options.stats && jit) {
+					std::cerr << "jit: compiled " << jit->CompiledLoops() << " of "
+						<< jit->HotLoops() << " hot loops" << std::endl;
+				}
+				break;
+			}
+			case Engine::Register: {
+				const execution::Program program = execution::Compile(parser.operations, parser.variables, parser.constants);
+				const execution::RegisterProgram registers = execution::CompileRegisters(program);
+				if (options.stats) {
+					std::cerr << "register: " << registers.code.size() << " instructions for "
+						<< program.code.size() << " stack instructions, "
+						<< registers.registers << " registers" << std::endl;
+				}
+				execution::Run(registers, context);
+				break;
+			}
+		}
+		if (options.time) {
+			// Buffered output belongs to the execution
+			execution::Stdout().Flush();
+			const double exec = Elapsed(start);
+			std::cerr << std::fixed << std::setprecision(3) << "time: lex " << lex << " parse " << parse
+				<< " optimize " << optimize << " exec " << exec << " ms" << std::endl;
 		}
 		return 0;
 	} catch (const std::exception& e) {
+		// Keep the program output ahead of the error
+		execution::Stdout().Flush();
 		std::cerr << e.what() << std::endl;
 		return 1;
 	}
-}
\ No newline at end of file
+}
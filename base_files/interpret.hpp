@@ -2,9 +2,42 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #include "../parser/parser.hpp"
 #include "../lexer/lexer.hpp"
 #include "../poliz/poliz.hpp"
 
-int Python(int argc, char* argv[]);
\ No newline at end of file
+enum class Engine {
+	Poliz,     // virtual Operation::Do per operation
+	Bytecode,  // flat instructions run by a single switch
+	Register,  // three-address instructions over a register file
+};
+
+struct Options {
+	std::string file;
+	Engine engine = Engine::Poliz;
+	int optimize = 0;
+	// Print compile statistics to stderr
+	bool stats = false;
+	// Flush the program output after every write
+	bool unbuffered = false;
+	// Compile hot loops to native code; bytecode engine only
+	bool jit = true;
+	// Print the script translated to C++ instead of running it
+	bool emit_cpp = false;
+	// Time every operation and write the collapsed stacks here; poliz engine only
+	std::string profile;
+	// Samples per second of CPU time for the sampling profiler, 0 when off; poliz and bytecode engines
+	int sample_rate = 0;
+	// Where the sampling profiler writes the collapsed stacks, profile.folded by default
+	std::string sample_out;
+	// Print lex, parse, optimize and execution times to stderr
+	bool time = false;
+	// Lexer scanning kernels: scalar, sse2 or avx2; the widest the CPU runs when empty
+	std::string lexer;
+};
+
+Options ParseOptions(int argc, char* argv[]);
+
+int Python(int argc, char* argv[]);
@@ -0,0 +1,36 @@
+# Deep if/elif chains: most values fall through a dozen comparisons before a branch is taken
+a = 0
+b = 0
+c = 0
+d = 0
+for i in range(1000000):
+    n = i % 16
+    if n == 0:
+        a = a + 1
+    elif n == 1:
+        b = b + 1
+    elif n == 2:
+        c = c + 1
+    elif n == 3:
+        d = d + 1
+    elif n == 4:
+        a = a - 1
+    elif n == 5:
+        b = b - 1
+    elif n == 6:
+        c = c - 1
+    elif n == 7:
+        d = d - 1
+    elif n == 8:
+        a = a + 2
+    elif n == 9:
+        b = b + 2
+    elif n == 10:
+        c = c + 2
+    elif n == 11:
+        d = d + 2
+    elif n < 14 and i % 2 == 0:
+        a = a + n
+    else:
+        d = d + n
+print(a, b, c, d)
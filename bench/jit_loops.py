@@ -0,0 +1,13 @@
+# Hot int and float loops that stay on numbers, the case the bytecode jit compiles
+total = 0
+i = 0
+while i < 3000000:
+    total = total + i % 7 * 3 - i / 5
+    i = i + 1
+print(total)
+x = 0.0
+for k in range(3000000):
+    x = x * 0.5 + k / 3.0
+    if x > 1000.0:
+        x = x - 1000.0
+print(x)
@@ -0,0 +1,3 @@
+# One short line per iteration: dominated by output cost when stdout is a pipe or file
+for i in range(1000000):
+    print(i)
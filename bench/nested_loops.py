@@ -0,0 +1,13 @@
+# Nested range loops: short inner loops pay the loop setup and exit on every outer iteration
+total = 0
+for i in range(600):
+    for j in range(600):
+        for k in range(10):
+            total = total + (i * j + k) % 7
+print(total)
+count = 0
+for i in range(2000):
+    for j in range(i % 50):
+        if (i + j) % 3 == 0:
+            count = count + 1
+print(count)
@@ -0,0 +1,10 @@
+# Data cleaning: numeric fields arrive as strings and are converted with int() and float()
+count = "  1234567"
+price = "1999.95"
+ratio = "-3.5e-2"
+total = 0
+amount = 0.0
+for i in range(1000000):
+    total = total + int(count) % 100
+    amount = amount + float(price) + float(ratio)
+print(total, amount)
@@ -0,0 +1,4 @@
+# Number formatting: 10^7 ints and 10^7 floats through print
+for i in range(10000000):
+    print(i)
+    print(i * 0.25 + 0.1)
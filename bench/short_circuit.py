@@ -0,0 +1,11 @@
+# Cheap checks guarding expensive ones: the right operand should not run once the result is known
+done = True
+pending = False
+word = "abc"
+hits = 0
+for i in range(1000000):
+    if done or str(i) * 20 == word:
+        hits = hits + 1
+    if pending and int(str(i) + "0") % 7 == 0:
+        hits = hits - 1
+print(hits)
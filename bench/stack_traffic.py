@@ -0,0 +1,9 @@
+# Operand stack traffic: every statement pushes and pops ints, floats and bools
+acc = 0
+real = 0.0
+flag = False
+for i in range(1000000):
+    acc = acc + i % 7 - 3
+    real = real * 0.5 + 1.5
+    flag = not flag and acc > 0 or i < 10
+print(acc, real, flag)
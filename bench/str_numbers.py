@@ -0,0 +1,5 @@
+# Number formatting through str() and concatenation
+line = ""
+for i in range(1000000):
+    line = str(i) + " " + str(i * 0.25 + 0.1)
+print(line)
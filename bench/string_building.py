@@ -0,0 +1,14 @@
+# String building: repeated concatenation, repetition and comparison of growing strings
+line = ""
+words = 0
+for i in range(1000000):
+    line = line + "ab"
+    if i % 100 == 99:
+        if line > "ab" * 50:
+            words = words + 1
+        line = ""
+print(words, line)
+text = ""
+for i in range(2000):
+    text = text + str(i % 10) * 3
+print(text == text + "", text * 2 > text)
@@ -0,0 +1,16 @@
+# String operand reads: comparisons, casts and repetition of long string variables
+text = "0123456789" * 100
+number = "1234567"
+real = "3.25"
+same = 0
+total = 0
+scale = 0.0
+for i in range(200000):
+    if text == text:
+        same = same + 1
+    if text < text + "x":
+        same = same + 1
+    total = total + int(number) % 10
+    scale = scale + float(real)
+    line = str(text)
+print(same, total, scale, line == text)
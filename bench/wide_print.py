@@ -0,0 +1,6 @@
+# Report-style output: wide rows of mixed values printed with one call each
+name = "item"
+price = 9.75
+flag = True
+for i in range(20000):
+    print(i, name, price, flag, i * 2, name, price * i, not flag, i % 7, name, i, name, price, flag, i * 3, name, price, flag, i, name)
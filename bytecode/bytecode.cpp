@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "bytecode.hpp"
+#include "../jit/jit.hpp"
+
+namespace execution {
+
+void Program::Emit(Opcode opcode, std::uint8_t aux, std::uint32_t operand, int pos, int line) {
+	Emit({opcode, aux, operand}, pos, line);
+}
+
+void Program::Emit(const Instruction& instruction, int pos, int line) {
+	code.push_back(instruction);
+	locations.push_back({pos, line});
+}
+
+std::uint32_t Program::AddSlowPath(const Operation* operation) {
+	slow_paths.push_back(operation);
+	return slow_paths.size() - 1;
+}
+
+std::uint32_t Program::AddMath(MathFunction function) {
+	math.push_back(function);
+	return math.size() - 1;
+}
+
+bool IsJump(Opcode opcode) {
+	switch (opcode) {
+		case Opcode::Go:
+		case Opcode::If:
+		case Opcode::ExecuteIf:
+		case Opcode::ForRangeTest:
+		case Opcode::ForRangeNext:
+			return true;
+		default:
+			return false;
+	}
+}
+
+std::string Describe(const Instruction& instruction) {
+	static const char* const kNames[] = {
+		"PushConst", "Load", "Store", "AddOne", "Go", "If", "Binary", "UnaryMinus", "Not", "GetRange", "Cast",
+		"Print", "TypedBinary", "ExecuteVariables", "ExecuteIf", "ForRangeTest", "ForRangeNext",
+	};
+	const std::string name = kNames[static_cast<int>(instruction.opcode)];
+	switch (instruction.opcode) {
+		case Opcode::Binary:
+		case Opcode::TypedBinary:
+		case Opcode::ExecuteVariables:
+		case Opcode::ExecuteIf:
+		case Opcode::Cast:
+			return name + " " + Lexeme::TypeToString(Lexeme::LexemeType(instruction.aux));
+		default:
+			return name;
+	}
+}
+
+namespace {
+
+int Pops(const Instruction& instruction) {
+	switch (instruction.opcode) {
+		case Opcode::PushConst:
+		case Opcode::Load:
+		case Opcode::Go:
+		case Opcode::ExecuteVariables:
+		case Opcode::ForRangeTest:
+		case Opcode::ForRangeNext:
+			return 0;
+		case Opcode::Binary:
+		case Opcode::TypedBinary:
+		case Opcode::ExecuteIf:
+			return 2;
+		case Opcode::Print:
+			return instruction.operand;
+		default:
+			return 1;
+	}
+}
+
+int Pushes(const Instruction& instruction, int depth) {
+	switch (instruction.opcode) {
+		case Opcode::PushConst:
+		case Opcode::Load:
+		case Opcode::Binary:
+		case Opcode::TypedBinary:
+		case Opcode::UnaryMinus:
+		case Opcode::Not:
+		case Opcode::Cast:
+		case Opcode::ExecuteVariables:
+			return 1;
+		case Opcode::GetRange:
+			// range(stop) also pushes the implicit start
+			return depth == 1 ? 2 : 1;
+		default:
+			return 0;
+	}
+}
+
+// Jumps and stores carry no position, so the closest preceding one is reported
+int LineOf(const Program& program, OperationIndex index) {
+	while (index > 0 && program.locations[index].line == 0) {
+		--index;
+	}
+	return program.locations[index].line;
+}
+
+} // namespace
+
+std::vector<int> StackDepths(const Program& program) {
+	const std::size_t size = program.code.size();
+	std::vector<int> depths(size + 1, -1);
+	if (size == 0) {
+		depths[0] = 0;
+		return depths;
+	}
+	std::vector<OperationIndex> pending;
+
+	auto reach = [&](OperationIndex index, int depth, OperationIndex from) {
+		if (index == size) {
+			// Values left over at exit are never read
+			depths[size] = std::max(depths[size], depth);
+		}
+		else if (depths[index] == -1) {
+			depths[index] = depth;
+			pending.push_back(index);
+		}
+		else if (depths[index] != depth) {
+			throw std::runtime_error("line " + std::to_string(LineOf(program, from)) +
+				": StackError: operand stack does not balance");
+		}
+	};
+
+	reach(0, 0, 0);
+	while (!pending.empty()) {
+		const OperationIndex index = pending.back();
+		pending.pop_back();
+		const Instruction& instruction = program.code[index];
+		const int depth = depths[index];
+		if (depth < Pops(instruction)) {
+			throw std::runtime_error("line " + std::to_string(LineOf(program, index)) +
+				": StackError: operand stack underflow");
+		}
+		const int next = depth - Pops(instruction) + Pushes(instruction, depth);
+		if (IsJump(instruction.opcode)) {
+			reach(instruction.operand, next, index);
+		}
+		if (instruction.opcode != Opcode::Go) {
+			reach(index + 1, next, index);
+		}
+	}
+	return depths;
+}
+
+std::size_t MaxStackDepth(const Program& program) {
+	const std::vector<int> depths = StackDepths(program);
+	std::size_t max_depth = 0;
+	for (OperationIndex index = 0; index < program.code.size(); ++index) {
+		if (depths[index] < 0) {
+			continue;
+		}
+		const Instruction& instruction = program.code[index];
+		// The NameError path of the fused load; load; binop replays the loads on the stack
+		const int extra = instruction.opcode == Opcode::ExecuteVariables ? 2 : 0;
+		const int after = depths[index] - Pops(instruction) + Pushes(instruction, depths[index]);
+		max_depth = std::max<std::size_t>(max_depth, std::max(depths[index] + extra, after));
+	}
+	return max_depth;
+}
+
+Program Compile(const Operations& operations, const std::vector<VariableName>& variables,
+				const std::vector<PolymorphicValue>& constants) {
+	Program program;
+	program.variables = variables;
+	program.constants = constants;
+	program.code.reserve(operations.size());
+	program.locations.reserve(operations.size());
+	for (const auto& operation : operations) {
+		operation->Encode(program);
+	}
+	return program;
+}
+
+void Run(const Program& program, Context& context, Jit* jit) {
+	const Instruction* code = program.code.data();
+	const OperationIndex size = program.code.size();
+
+	while (context.operation_index < size) {
+		const OperationIndex index = context.operation_index++;
+		context.current_index.store(index, std::memory_order_relaxed);
+		const Instruction& instruction = code[index];
+
+		switch (instruction.opcode) {
+			case Opcode::PushConst:
+				context.stack.emplace(program.constants[instruction.operand]);
+				break;
+			case Opcode::Load: {
+				Variable& variable = context.variables[instruction.operand];
+				if (!variable.defined) {
+					const Location& location = program.locations[index];
+					throw std::runtime_error("line " + std::to_string(location.line) + ":" +
+						std::to_string(location.pos) + ": NameError: name '" +
+						program.variables[instruction.operand] + "' is not defined");
+				}
+				context.stack.emplace(&variable);
+				break;
+			}
+			case Opcode::Store: {
+				Variable& variable = context.variables[instruction.operand];
+				variable.value = context.stack.top().Get();
+				variable.defined = true;
+				context.stack.pop();
+				break;
+			}
+			case Opcode::AddOne: {
+				Variable& variable = context.variables[instruction.operand];
+				variable.value = int(context.stack.top().Get()) + 1;
+				variable.defined = true;
+				context.stack.pop();
+				break;
+			}
+			case Opcode::Go:
+				if (instruction.operand <= index && jit && jit->Enter(instruction.operand, index, context)) {
+					break;
+				}
+				context.operation_index = instruction.operand;
+				break;
+			case Opcode::If: {
+				const bool truth = bool(context.stack.top().Get());
+				context.stack.pop();
+				if (!truth) {
+					context.operation_index = instruction.operand;
+				}
+				break;
+			}
+			case Opcode::Binary: {
+				StackValue op2 = context.stack.top();
+				context.stack.pop();
+				StackValue op1 = context.stack.top();
+				context.stack.pop();
+				const Location& location = program.locations[index];
+				context.stack.emplace(DoBinary(OperationType(instruction.aux), op1, op2, location.pos, location.line));
+				break;
+			}
+			case Opcode::TypedBinary: {
+				const MathFunction math = program.math[instruction.operand3];
+				StackValue op2 = context.stack.top();
+				context.stack.pop();
+				StackValue op1 = context.stack.top();
+				context.stack.pop();
+				context.stack.emplace(math(op1, op2));
+				break;
+			}
+			case Opcode::Not: {
+				const PolymorphicValue value(!bool(context.stack.top().Get()));
+				context.stack.pop();
+				context.stack.emplace(value);
+				break;
+			}
+			case Opcode::UnaryMinus: {
+				const Location& location = program.locations[index];
+				UnaryMinusOperation(location.pos, location.line).Do(context);
+				break;
+			}
+			case Opcode::GetRange: {
+				const Location& location = program.locations[index];
+				GetRangeOperation(location.pos, location.line).Do(context);
+				break;
+			}
+			case Opcode::Cast: {
+				const Location& location = program.locations[index];
+				Cast(OperationType(instruction.aux), location.pos, location.line).Do(context);
+				break;
+			}
+			case Opcode::Print:
+				PrintOperation(instruction.operand).Do(context);
+				break;
+			case Opcode::ExecuteVariables: {
+				Variable& op1 = context.variables[instruction.operand];
+				Variable& op2 = context.variables[instruction.operand2];
+				if (!op1.defined || !op2.defined) {
+					program.slow_paths[instruction.operand3]->Do(context);
+					break;
+				}
+				const Location& location = program.locations[index];
+				context.stack.emplace(DoBinary(OperationType(instruction.aux), &op1, &op2, location.pos, location.line));
+				break;
+			}
+			case Opcode::ExecuteIf: {
+				StackValue op2 = context.stack.top();
+				context.stack.pop();
+				StackValue op1 = context.stack.top();
+				context.stack.pop();
+				const Location& location = program.locations[index];
+				if (!bool(DoBinary(OperationType(instruction.aux), op1, op2, location.pos, location.line).Get())) {
+					context.operation_index = instruction.operand;
+				}
+				break;
+			}
+			case Opcode::ForRangeTest: {
+				const Location& location = program.locations[index];
+				if (!RangeContinues(context, instruction.operand2, instruction.operand3, location.pos, location.line)) {
+					context.operation_index = instruction.operand;
+				}
+				break;
+			}
+			case Opcode::ForRangeNext: {
+				Variable& variable = context.variables[instruction.operand2];
+				variable.value = int(variable.value) + 1;
+				const Location& location = program.locations[index];
+				if (RangeContinues(context, instruction.operand2, instruction.operand3, location.pos, location.line)) {
+					if (jit && jit->Enter(instruction.operand, index, context)) {
+						break;
+					}
+					context.operation_index = instruction.operand;
+				}
+				break;
+			}
+		}
+	}
+}
+
+} // namespace execution
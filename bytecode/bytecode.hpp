@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+
+namespace execution {
+
+class Jit;
+
+enum class Opcode : std::uint8_t {
+	PushConst,  // operand: constant index
+	Load,       // operand: slot
+	Store,      // operand: slot
+	AddOne,     // operand: slot
+	Go,         // operand: target
+	If,         // operand: target
+	Binary,     // aux: operation type
+	UnaryMinus,
+	Not,
+	GetRange,
+	Cast,       // aux: cast type
+	Print,      // operand: number of values
+	TypedBinary,  // aux: operation type, operand, operand2: operand types proven by Specialize(),
+	              // operand3: index of its function in Program::math
+
+	// Fused superinstructions
+	ExecuteVariables,  // aux: operation type, operand, operand2: slots, operand3: slow path
+	ExecuteIf,         // aux: operation type, operand: target
+	ForRangeTest,      // operand: exit target, operand2: counter slot, operand3: bound slot
+	ForRangeNext,      // operand: body target, operand2: counter slot, operand3: bound slot
+};
+
+struct Instruction {
+	Opcode opcode;
+	std::uint8_t aux = 0;
+	std::uint32_t operand = 0;
+	std::uint32_t operand2 = 0;
+	std::uint32_t operand3 = 0;
+};
+
+// Only read when reporting errors, so it is kept apart from the code
+struct Location {
+	int pos;
+	int line;
+};
+
+struct Program {
+	std::vector<Instruction> code;
+	std::vector<Location> locations;
+	std::vector<PolymorphicValue> constants;
+	std::vector<VariableName> variables;
+	// Operations that handle the rare cases of fused instructions; borrowed from the parser output
+	std::vector<const Operation*> slow_paths;
+	// Functions of the TypedBinary instructions, resolved when they are compiled
+	std::vector<MathFunction> math;
+
+	void Emit(Opcode opcode, std::uint8_t aux = 0, std::uint32_t operand = 0, int pos = 0, int line = 0);
+	void Emit(const Instruction& instruction, int pos = 0, int line = 0);
+	std::uint32_t AddSlowPath(const Operation* operation);
+	std::uint32_t AddMath(MathFunction function);
+};
+
+bool IsJump(Opcode opcode);
+
+// Opcode name, with the operator or cast for those that carry one: "Binary +", "Cast int()"
+std::string Describe(const Instruction& instruction);
+
+// Operand stack depth before each instruction and at the end, -1 where unreachable.
+// Throws when the stack underflows or paths meet with different depths.
+std::vector<int> StackDepths(const Program& program);
+
+// The deepest the operand stack gets on any path; verifies the program like StackDepths
+std::size_t MaxStackDepth(const Program& program);
+
+// Lowers parser output into bytecode; instruction indices match operation indices
+Program Compile(const Operations& operations, const std::vector<VariableName>& variables,
+				const std::vector<PolymorphicValue>& constants);
+
+// Hands hot loops to the jit when one is given
+void Run(const Program& program, Context& context, Jit* jit = nullptr);
+
+} // namespace execution
@@ -0,0 +1,167 @@
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "format.hpp"
+
+namespace execution {
+
+namespace {
+
+char* Copy(char* first, const char* str) {
+	const std::size_t size = std::strlen(str);
+	std::memcpy(first, str, size);
+	return first + size;
+}
+
+char* Fill(char* first, int count, char c) {
+	for (int i = 0; i < count; ++i) {
+		*first++ = c;
+	}
+	return first;
+}
+
+// Skips whitespace and a plus sign; a minus sign is left for std::from_chars
+const char* SkipPrefix(const char* first, const char* last) {
+	while (first != last && std::isspace(static_cast<unsigned char>(*first))) {
+		++first;
+	}
+	if (first != last && *first == '+' && (first + 1 == last || first[1] != '-')) {
+		++first;
+	}
+	return first;
+}
+
+ParseStatus Status(std::errc error) {
+	if (error == std::errc()) {
+		return ParseStatus::Ok;
+	}
+	switch (error) {
+		case std::errc::result_out_of_range:
+			return ParseStatus::OutOfRange;
+		default:
+			return ParseStatus::Invalid;
+	}
+}
+
+bool IsHexPrefix(const char* first, const char* last) {
+	return last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'X') && first[2] != '-';
+}
+
+} // namespace
+
+char* FormatInt(char* first, int value) {
+	return std::to_chars(first, first + kMaxNumberChars, value).ptr;
+}
+
+char* FormatReal(char* first, double value) {
+	if (std::isnan(value)) {
+		return Copy(first, "nan");
+	}
+	if (std::isinf(value)) {
+		return Copy(first, value < 0 ? "-inf" : "inf");
+	}
+
+	// Shortest round-trip digits as [-]d.ddde±xx, then laid out again
+	char scientific[kMaxNumberChars];
+	const char* end = std::to_chars(scientific, scientific + kMaxNumberChars, value,
+		std::chars_format::scientific).ptr;
+	const char* p = scientific;
+	if (*p == '-') {
+		*first++ = *p++;
+	}
+	char digits[kMaxNumberChars];
+	int count = 0;
+	for (; *p != 'e'; ++p) {
+		if (*p != '.') {
+			digits[count++] = *p;
+		}
+	}
+	++p;
+	if (*p == '+') {
+		++p;
+	}
+	int exponent = 0;
+	std::from_chars(p, end, exponent);
+
+	// Digits before the decimal point
+	const int point = exponent + 1;
+	if (point > -4 && point <= 16) {
+		if (point <= 0) {
+			first = Copy(first, "0.");
+			first = Fill(first, -point, '0');
+			std::memcpy(first, digits, count);
+			return first + count;
+		}
+		if (point >= count) {
+			std::memcpy(first, digits, count);
+			first = Fill(first + count, point - count, '0');
+			return Copy(first, ".0");
+		}
+		std::memcpy(first, digits, point);
+		first += point;
+		*first++ = '.';
+		std::memcpy(first, digits + point, count - point);
+		return first + count - point;
+	}
+
+	*first++ = digits[0];
+	if (count > 1) {
+		*first++ = '.';
+		std::memcpy(first, digits + 1, count - 1);
+		first += count - 1;
+	}
+	*first++ = 'e';
+	*first++ = exponent < 0 ? '-' : '+';
+	if (std::abs(exponent) < 10) {
+		*first++ = '0';
+	}
+	return FormatInt(first, std::abs(exponent));
+}
+
+std::string IntToString(int value) {
+	char buffer[kMaxNumberChars];
+	return std::string(buffer, FormatInt(buffer, value));
+}
+
+std::string RealToString(double value) {
+	char buffer[kMaxNumberChars];
+	return std::string(buffer, FormatReal(buffer, value));
+}
+
+ParseStatus ParseInt(std::string_view text, int& value) {
+	const char* last = text.data() + text.size();
+	return Status(std::from_chars(SkipPrefix(text.data(), last), last, value).ec);
+}
+
+ParseStatus ParseReal(std::string_view text, double& value) {
+	const char* last = text.data() + text.size();
+	const char* first = SkipPrefix(text.data(), last);
+	std::from_chars_result result;
+	const bool negative = first != last && *first == '-';
+	if (IsHexPrefix(first + negative, last)) {
+		// std::from_chars takes hex digits without the 0x
+		result = std::from_chars(first + negative + 2, last, value, std::chars_format::hex);
+		if (result.ec == std::errc::invalid_argument) {
+			// Only the leading 0 is a number
+			value = 0.0;
+			result.ec = std::errc();
+		}
+		if (negative) {
+			value = -value;
+		}
+	}
+	else {
+		result = std::from_chars(first, last, value);
+	}
+	if (result.ec == std::errc() && std::fpclassify(value) == FP_SUBNORMAL) {
+		return ParseStatus::OutOfRange;
+	}
+	return Status(result.ec);
+}
+
+} // namespace execution
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace execution {
+
+// Enough room for any text FormatInt and FormatReal produce
+const std::size_t kMaxNumberChars = 32;
+
+// Write the number at first and return the end of the text, like std::to_chars.
+// Reals get the shortest digits that read back to the same value, laid out the
+// way Python prints floats: 2.5, 3.0, 1e-05, 1.5e+300, inf, nan.
+char* FormatInt(char* first, int value);
+char* FormatReal(char* first, double value);
+
+std::string IntToString(int value);
+std::string RealToString(double value);
+
+enum class ParseStatus { Ok, Invalid, OutOfRange };
+
+// Read a number from the start of the text the way std::stoi and std::stod do:
+// leading whitespace and a sign are skipped and trailing characters ignored.
+// Reals that underflow to subnormals are out of range, as with strtod.
+// Nothing is allocated or thrown.
+ParseStatus ParseInt(std::string_view text, int& value);
+ParseStatus ParseReal(std::string_view text, double& value);
+
+} // namespace execution
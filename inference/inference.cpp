@@ -0,0 +1,449 @@
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "inference.hpp"
+
+namespace execution {
+
+namespace {
+
+bool IsNumber(StaticType type) {
+	return type == Int || type == Real || type == Logic;
+}
+
+bool IsComparison(OperationType operation) {
+	switch (operation) {
+		case Lexeme::Less:
+		case Lexeme::LessEq:
+		case Lexeme::Greater:
+		case Lexeme::GreaterEq:
+		case Lexeme::Equal:
+		case Lexeme::NotEqual:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// Past this many reached block entries times variables with more than one type,
+// those variables keep their one type for the whole program too
+const std::size_t kFlowBudget = std::size_t(1) << 22;
+
+// Returns true when the target state changed
+bool Merge(TypeState& target, const TypeState& state) {
+	if (!target.reached) {
+		target = state;
+		target.reached = true;
+		return true;
+	}
+	bool changed = false;
+	auto join = [&changed](std::vector<StaticType>& into, const std::vector<StaticType>& from) {
+		for (std::size_t i = 0; i < into.size(); ++i) {
+			const StaticType joined = Join(into[i], from[i]);
+			changed = changed || joined != into[i];
+			into[i] = joined;
+		}
+	};
+	join(target.stack, state.stack);
+	join(target.variables, state.variables);
+	return changed;
+}
+
+// The first instruction and every jump target. Any other instruction is only
+// reached from the one before it, so its types need no state of their own
+std::vector<bool> BlockEntries(const Program& program) {
+	std::vector<bool> entries(program.code.size() + 1, false);
+	entries[0] = true;
+	for (const Instruction& instruction : program.code) {
+		if (IsJump(instruction.opcode)) {
+			entries[instruction.operand] = true;
+		}
+	}
+	return entries;
+}
+
+// Runs the blocks of a program to a fixed point of the types in ProgramTypes
+class Inference {
+  public:
+	Inference(const Program& program, ProgramTypes& types);
+
+	// Runs every block again until no state or program-wide type changes
+	void Solve();
+
+	// Carries state through the block at start, calling visit before every
+	// instruction and leave for every block entry control goes on to
+	template <typename Visit, typename Leave>
+	void RunBlock(OperationIndex start, TypeState state, Visit visit, Leave leave);
+
+	StaticType Type(const TypeState& state, VariableSlot slot) const;
+
+  private:
+	// Widening a program-wide type sends the blocks that read it back to pending_
+	void Assign(TypeState& state, VariableSlot slot, StaticType type);
+	// Applies the instruction to the state; false when control never leaves it
+	bool Transfer(OperationIndex index, TypeState& state);
+
+	const Program& program_;
+	ProgramTypes& types_;
+	const std::vector<bool> entries_;
+	// Entries of the blocks that load each variable
+	std::vector<std::vector<OperationIndex>> readers_;
+	// Block entries to run again, lowest first so that straight-line programs take
+	// one pass however many types they widen
+	std::set<OperationIndex> pending_;
+};
+
+Inference::Inference(const Program& program, ProgramTypes& types):
+	program_(program), types_(types), entries_(BlockEntries(program)), readers_(program.variables.size()) {
+	OperationIndex block = 0;
+	auto read = [this, &block](VariableSlot slot) {
+		if (readers_[slot].empty() || readers_[slot].back() != block) {
+			readers_[slot].push_back(block);
+		}
+	};
+	for (OperationIndex index = 0; index < program.code.size(); ++index) {
+		const Instruction& instruction = program.code[index];
+		block = entries_[index] ? index : block;
+		if (instruction.opcode == Opcode::Load) {
+			read(instruction.operand);
+		}
+		else if (instruction.opcode == Opcode::ExecuteVariables) {
+			read(instruction.operand);
+			read(instruction.operand2);
+		}
+	}
+}
+
+void Inference::Solve() {
+	TypeState& first = types_.blocks[0];
+	first.reached = true;
+	first.variables.assign(types_.flow_variables, kNoType);
+	pending_ = {0};
+	auto leave = [this](OperationIndex target, const TypeState& state) {
+		if (Merge(types_.blocks[target], state)) {
+			pending_.insert(target);
+		}
+	};
+	while (!pending_.empty()) {
+		const OperationIndex start = *pending_.begin();
+		pending_.erase(pending_.begin());
+		const auto block = types_.blocks.find(start);
+		// Readers of a widened type may not be reached yet
+		if (block != types_.blocks.end() && block->second.reached) {
+			RunBlock(start, block->second, [](OperationIndex, const TypeState&) {}, leave);
+		}
+	}
+}
+
+template <typename Visit, typename Leave>
+void Inference::RunBlock(OperationIndex start, TypeState state, Visit visit, Leave leave) {
+	for (OperationIndex index = start; index < program_.code.size(); ++index) {
+		if (index != start && entries_[index]) {
+			leave(index, state);
+			return;
+		}
+		visit(index, state);
+		if (!Transfer(index, state)) {
+			return;
+		}
+		const Instruction& instruction = program_.code[index];
+		if (IsJump(instruction.opcode)) {
+			leave(instruction.operand, state);
+		}
+		if (instruction.opcode == Opcode::Go) {
+			return;
+		}
+	}
+}
+
+StaticType Inference::Type(const TypeState& state, VariableSlot slot) const {
+	const std::size_t flow = types_.flow_slots[slot];
+	return flow == kNoFlowSlot ? types_.variables[slot] : state.variables[flow];
+}
+
+void Inference::Assign(TypeState& state, VariableSlot slot, StaticType type) {
+	const std::size_t flow = types_.flow_slots[slot];
+	if (flow != kNoFlowSlot) {
+		state.variables[flow] = type;
+		return;
+	}
+	const StaticType joined = Join(types_.variables[slot], type);
+	if (joined != types_.variables[slot]) {
+		types_.variables[slot] = joined;
+		pending_.insert(readers_[slot].begin(), readers_[slot].end());
+	}
+}
+
+bool Inference::Transfer(OperationIndex index, TypeState& state) {
+	const Program& program = program_;
+	const Instruction& instruction = program.code[index];
+	std::vector<StaticType>& stack = state.stack;
+	auto pop = [&stack]() {
+		const StaticType type = stack.back();
+		stack.pop_back();
+		return type;
+	};
+	switch (instruction.opcode) {
+		case Opcode::PushConst:
+			stack.push_back(program.constants[instruction.operand].GetType());
+			return true;
+		case Opcode::Load:
+			// Never assigned on any path, so always a NameError
+			if (Type(state, instruction.operand) == kNoType) {
+				return false;
+			}
+			stack.push_back(Type(state, instruction.operand));
+			return true;
+		case Opcode::Store:
+			Assign(state, instruction.operand, pop());
+			return true;
+		case Opcode::AddOne:
+			pop();
+			Assign(state, instruction.operand, Int);
+			return true;
+		case Opcode::Go:
+			return true;
+		case Opcode::If:
+			pop();
+			return true;
+		case Opcode::Binary:
+		case Opcode::TypedBinary: {
+			const StaticType type2 = pop();
+			const StaticType type1 = pop();
+			stack.push_back(BinaryType(OperationType(instruction.aux), type1, type2));
+			return true;
+		}
+		case Opcode::UnaryMinus: {
+			const StaticType type = pop();
+			stack.push_back(type == Int || type == Logic ? Int : type == Real ? Real : kAnyType);
+			return true;
+		}
+		case Opcode::Not:
+			pop();
+			stack.push_back(Logic);
+			return true;
+		case Opcode::GetRange:
+			if (stack.size() == 1) {
+				stack.insert(stack.begin(), Int);
+			}
+			return true;
+		case Opcode::Cast:
+			pop();
+			stack.push_back(CastType(OperationType(instruction.aux)));
+			return true;
+		case Opcode::Print:
+			stack.resize(stack.size() - instruction.operand);
+			return true;
+		case Opcode::ExecuteVariables: {
+			const StaticType type1 = Type(state, instruction.operand);
+			const StaticType type2 = Type(state, instruction.operand2);
+			if (type1 == kNoType || type2 == kNoType) {
+				return false;
+			}
+			stack.push_back(BinaryType(OperationType(instruction.aux), type1, type2));
+			return true;
+		}
+		case Opcode::ExecuteIf:
+			pop();
+			pop();
+			return true;
+		case Opcode::ForRangeTest:
+			return true;
+		case Opcode::ForRangeNext:
+			Assign(state, instruction.operand2, Int);
+			return true;
+	}
+	return true;
+}
+
+std::shared_ptr<Operation> ConcreteCast(OperationType cast, const Location& location) {
+	switch (cast) {
+		case Lexeme::Bool:
+			return std::make_shared<BoolCast>();
+		case Lexeme::Int:
+			return std::make_shared<IntCast>(location.pos, location.line);
+		case Lexeme::Float:
+			return std::make_shared<FloatCast>(location.pos, location.line);
+		default:
+			return std::make_shared<StrCast>();
+	}
+}
+
+} // namespace
+
+StaticType Join(StaticType a, StaticType b) {
+	if (a == kNoType) {
+		return b;
+	}
+	if (b == kNoType || a == b) {
+		return a;
+	}
+	return kAnyType;
+}
+
+StaticType BinaryType(OperationType operation, StaticType type1, StaticType type2) {
+	if (operation == Lexeme::And || operation == Lexeme::Or) {
+		return Logic;
+	}
+	if (type1 == kAnyType || type2 == kAnyType) {
+		return kAnyType;
+	}
+	if (IsNumber(type1) && IsNumber(type2)) {
+		if (operation == Lexeme::Mod && (type1 == Real || type2 == Real)) {
+			return kAnyType;
+		}
+		if (IsComparison(operation)) {
+			return Logic;
+		}
+		return type1 == Real || type2 == Real ? Real : Int;
+	}
+	if (type1 == Str && type2 == Str) {
+		if (operation == Lexeme::Add) {
+			return Str;
+		}
+		return IsComparison(operation) ? Logic : kAnyType;
+	}
+	if (operation == Lexeme::Mul && ((type1 == Str && type2 == Int) || (type1 == Int && type2 == Str))) {
+		return Str;
+	}
+	return operation == Lexeme::Equal ? Logic : kAnyType;
+}
+
+StaticType CastType(OperationType cast) {
+	switch (cast) {
+		case Lexeme::Bool:
+			return Logic;
+		case Lexeme::Int:
+			return Int;
+		case Lexeme::Float:
+			return Real;
+		default:
+			return Str;
+	}
+}
+
+ProgramTypes InferTypes(const Program& program) {
+	// StackDepths rejects programs whose paths meet with different depths
+	StackDepths(program);
+	const std::size_t count = program.variables.size();
+	ProgramTypes types;
+	types.variables.assign(count, kNoType);
+	types.flow_slots.assign(count, kNoFlowSlot);
+	Inference(program, types).Solve();
+
+	// Only the variables that take more than one type can gain from being followed
+	// along the paths, and only while their states fit kFlowBudget
+	std::vector<VariableSlot> mixed;
+	for (VariableSlot slot = 0; slot < count; ++slot) {
+		if (types.variables[slot] == kAnyType) {
+			mixed.push_back(slot);
+		}
+	}
+	if (mixed.empty() || mixed.size() > kFlowBudget / types.blocks.size()) {
+		return types;
+	}
+	for (std::size_t flow = 0; flow < mixed.size(); ++flow) {
+		types.flow_slots[mixed[flow]] = flow;
+	}
+	types.flow_variables = mixed.size();
+	types.blocks.clear();
+	Inference(program, types).Solve();
+	return types;
+}
+
+Specialization Specialize(Operations& operations, const std::vector<VariableName>& variables,
+						const std::vector<PolymorphicValue>& constants) {
+	const Program program = Compile(operations, variables, constants);
+	ProgramTypes types = InferTypes(program);
+	Inference inference(program, types);
+	Specialization result;
+	// The kMathBinaries entry every run of the site takes, nullptr where it is not proven
+	auto proven = [&](OperationType operation, StaticType type1, StaticType type2) -> MathFunction {
+		++result.binaries;
+		if (type1 == kNoType || type1 == kAnyType || type2 == kNoType || type2 == kAnyType ||
+			operation == Lexeme::And || operation == Lexeme::Or) {
+			return nullptr;
+		}
+		const MathFunction math = FindMath(operation, ValueType(type1), ValueType(type2));
+		if (math) {
+			++result.names[TypedName(operation, ValueType(type1), ValueType(type2))];
+			++result.specialized;
+		}
+		return math;
+	};
+	auto visit = [&](OperationIndex index, const TypeState& state) {
+		const Instruction& instruction = program.code[index];
+		const Location& location = program.locations[index];
+		const OperationType operation = OperationType(instruction.aux);
+		switch (instruction.opcode) {
+			case Opcode::Cast:
+				operations[index] = ConcreteCast(operation, location);
+				++result.casts;
+				return;
+			case Opcode::Binary: {
+				const StaticType type1 = state.stack[state.stack.size() - 2];
+				const StaticType type2 = state.stack.back();
+				if (proven(operation, type1, type2)) {
+					operations[index] = std::make_shared<TypedExecuteOperation>(
+						operation, ValueType(type1), ValueType(type2), location.pos, location.line);
+				}
+				return;
+			}
+			case Opcode::ExecuteVariables: {
+				const MathFunction math = proven(operation, inference.Type(state, instruction.operand),
+					inference.Type(state, instruction.operand2));
+				if (math) {
+					operations[index] = std::make_shared<ExecuteVariablesOperation>(
+						static_cast<const ExecuteVariablesOperation&>(*operations[index]), math);
+				}
+				return;
+			}
+			case Opcode::ExecuteIf: {
+				const MathFunction math = proven(operation, state.stack[state.stack.size() - 2], state.stack.back());
+				if (math) {
+					operations[index] = std::make_shared<ExecuteIfOperation>(
+						static_cast<const ExecuteIfOperation&>(*operations[index]), math);
+				}
+				return;
+			}
+			case Opcode::ForRangeTest:
+			case Opcode::ForRangeNext: {
+				// The tail increments the counter, which makes it an int whatever it held
+				const StaticType counter = instruction.opcode == Opcode::ForRangeNext ?
+					StaticType(Int) : inference.Type(state, instruction.operand2);
+				const StaticType bound = inference.Type(state, instruction.operand3);
+				// Only int against int skips the type checks RangeContinues makes
+				const bool ints = counter == Int && bound == Int;
+				if (!proven(Lexeme::Less, ints ? counter : kAnyType, ints ? bound : kAnyType)) {
+					return;
+				}
+				if (instruction.opcode == Opcode::ForRangeTest) {
+					operations[index] = std::make_shared<ForRangeTestOperation>(
+						static_cast<const ForRangeTestOperation&>(*operations[index]), true);
+				}
+				else {
+					operations[index] = std::make_shared<ForRangeNextOperation>(
+						static_cast<const ForRangeNextOperation&>(*operations[index]), true);
+				}
+				return;
+			}
+			default:
+				return;
+		}
+	};
+	// The blocks are at their fixed point, so one more run over each sees the
+	// final types of every reached instruction
+	for (const auto& block : types.blocks) {
+		if (block.second.reached) {
+			inference.RunBlock(block.first, block.second, visit, [](OperationIndex, const TypeState&) {});
+		}
+	}
+	return result;
+}
+
+} // namespace execution
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+
+namespace execution {
+
+// A ValueType, or one of the two below
+using StaticType = int;
+// Nothing seen yet, such as a variable before its first assignment
+const StaticType kNoType = -1;
+// Differs between paths
+const StaticType kAnyType = Logic + 1;
+
+StaticType Join(StaticType a, StaticType b);
+
+// The type kMathBinaries produces; kAnyType where an operand is or the operation raises
+StaticType BinaryType(OperationType operation, StaticType type1, StaticType type2);
+
+StaticType CastType(OperationType cast);
+
+// Marks a variable with one type for the whole program in ProgramTypes
+const std::size_t kNoFlowSlot = std::size_t(-1);
+
+struct TypeState {
+	bool reached = false;
+	std::vector<StaticType> stack;
+	// Types of the variables followed along the paths, by ProgramTypes::flow_slots
+	std::vector<StaticType> variables;
+};
+
+struct ProgramTypes {
+	// Operand stack and followed variable types at the start of every block: the
+	// first instruction and every jump target. The instructions in between get
+	// theirs by running the block from its start
+	std::map<OperationIndex, TypeState> blocks;
+	// Join of every type stored into each variable, its type wherever it is not followed
+	std::vector<StaticType> variables;
+	// Index into TypeState::variables of each followed variable, kNoFlowSlot for the rest
+	std::vector<std::size_t> flow_slots;
+	std::size_t flow_variables = 0;
+};
+
+// Gives every variable one type for the whole program, then follows the ones that
+// take more than one type along the paths while blocks times those variables stay small
+ProgramTypes InferTypes(const Program& program);
+
+struct Specialization {
+	std::size_t binaries = 0;
+	std::size_t specialized = 0;
+	std::size_t casts = 0;
+	// How often each specialized operation was emitted, by name
+	std::map<std::string, std::size_t> names;
+};
+
+// Replaces binary operations whose operand types are the same on every path with
+// TypedExecuteOperation, and every Cast with the concrete cast it dispatches to.
+// Fused sites keep their operation and take the proven kMathBinaries entry; all of
+// them, range loop tests included, count in binaries
+Specialization Specialize(Operations& operations, const std::vector<VariableName>& variables,
+						const std::vector<PolymorphicValue>& constants);
+
+} // namespace execution
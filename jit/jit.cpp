@@ -0,0 +1,874 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#endif
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "jit.hpp"
+
+namespace execution {
+
+#if defined(__x86_64__)
+
+namespace {
+
+// eax/ecx for ints and bools, xmm0/xmm1 for floats
+enum Register : std::uint8_t { kA = 0, kC = 1 };
+
+// Variables are addressed from r12, the scratch operand stack from rbx
+enum class Base { Variables, Stack };
+
+struct Memory {
+	Base base;
+	std::int32_t disp;
+};
+
+// Condition codes, added to 0x90 for setcc and 0x80 for jcc
+enum Condition : std::uint8_t {
+	kParity = 0xA, kNoParity = 0xB,
+	kBelow = 0x2, kAboveEqual = 0x3, kEqual = 0x4, kNotEqual = 0x5, kBelowEqual = 0x6, kAbove = 0x7,
+	kLess = 0xC, kGreaterEqual = 0xD, kLessEqual = 0xE, kGreater = 0xF,
+};
+
+// Just the instructions the loop templates use
+class Assembler {
+  public:
+	std::vector<std::uint8_t> code;
+
+	std::size_t Position() const { return code.size(); }
+
+	void Bytes(std::initializer_list<std::uint8_t> bytes) {
+		code.insert(code.end(), bytes);
+	}
+
+	void Int32(std::int32_t value) {
+		const std::size_t at = code.size();
+		code.resize(at + 4);
+		std::memcpy(&code[at], &value, 4);
+	}
+
+	void Int64(std::int64_t value) {
+		const std::size_t at = code.size();
+		code.resize(at + 8);
+		std::memcpy(&code[at], &value, 8);
+	}
+
+	// Points the rel32 at the given position to target
+	void Patch(std::size_t at, std::size_t target) {
+		const std::int32_t rel = std::int32_t(target) - std::int32_t(at + 4);
+		std::memcpy(&code[at], &rel, 4);
+	}
+
+	// push rbx; push r12; mov r12, rdi; mov rbx, rsi
+	void Prologue() { Bytes({0x53, 0x41, 0x54, 0x49, 0x89, 0xFC, 0x48, 0x89, 0xF3}); }
+	// pop r12; pop rbx; ret
+	void Epilogue() { Bytes({0x41, 0x5C, 0x5B, 0xC3}); }
+
+	void LoadInt(Register reg, Memory memory) { Access(0, {0x8B}, reg, memory); }
+	void StoreInt(Register reg, Memory memory) { Access(0, {0x89}, reg, memory); }
+	void LoadBool(Register reg, Memory memory) { Access(0, {0x0F, 0xB6}, reg, memory); }
+	void StoreBool(Register reg, Memory memory) { Access(0, {0x88}, reg, memory); }
+	void LoadReal(Register reg, Memory memory) { Access(0xF2, {0x0F, 0x10}, reg, memory); }
+	void StoreReal(Register reg, Memory memory) { Access(0xF2, {0x0F, 0x11}, reg, memory); }
+	void CompareInt(Register reg, Memory memory) { Access(0, {0x3B}, reg, memory); }
+
+	void MoveInt(Register reg, std::int32_t value) {
+		code.push_back(0xB8 + reg);
+		Int32(value);
+	}
+
+	// Goes through rax
+	void MoveReal(Register reg, std::int64_t bits) {
+		Bytes({0x48, 0xB8});
+		Int64(bits);
+		Bytes({0x66, 0x48, 0x0F, 0x6E, std::uint8_t(0xC0 | reg << 3)});
+	}
+
+	void AddInt() { Bytes({0x01, 0xC8}); }
+	void SubInt() { Bytes({0x29, 0xC8}); }
+	void MulInt() { Bytes({0x0F, 0xAF, 0xC1}); }
+	// cdq; idiv ecx
+	void DivInt() { Bytes({0x99, 0xF7, 0xF9}); }
+	void MoveRemainder() { Bytes({0x89, 0xD0}); }
+	void NegateInt() { Bytes({0xF7, 0xD8}); }
+	void IncrementInt() { Bytes({0x83, 0xC0, 0x01}); }
+	void CompareInt() { Bytes({0x39, 0xC8}); }
+	void CompareMinusOne(Register reg) { Bytes({0x83, std::uint8_t(0xF8 | reg), 0xFF}); }
+	void Test(Register reg) { Bytes({0x85, std::uint8_t(0xC0 | reg << 3 | reg)}); }
+
+	void AddReal() { Bytes({0xF2, 0x0F, 0x58, 0xC1}); }
+	void SubReal() { Bytes({0xF2, 0x0F, 0x5C, 0xC1}); }
+	void MulReal() { Bytes({0xF2, 0x0F, 0x59, 0xC1}); }
+	void DivReal() { Bytes({0xF2, 0x0F, 0x5E, 0xC1}); }
+	// ucomisd of first against second
+	void CompareReal(Register first, Register second) {
+		Bytes({0x66, 0x0F, 0x2E, std::uint8_t(0xC0 | first << 3 | second)});
+	}
+	// cvtsi2sd reg, eax
+	void IntToReal(Register reg) { Bytes({0xF2, 0x0F, 0x2A, std::uint8_t(0xC0 | reg << 3)}); }
+	// cvttsd2si eax, xmm0
+	void RealToInt() { Bytes({0xF2, 0x0F, 0x2C, 0xC0}); }
+	// xorpd xmm0, xmm1
+	void XorReal() { Bytes({0x66, 0x0F, 0x57, 0xC1}); }
+
+	void Set(Condition condition, Register reg) {
+		Bytes({0x0F, std::uint8_t(0x90 | condition), std::uint8_t(0xC0 | reg)});
+	}
+	// and al, cl / or al, cl
+	void AndBool() { Bytes({0x20, 0xC8}); }
+	void OrBool() { Bytes({0x08, 0xC8}); }
+	// movzx eax, al
+	void ExtendBool() { Bytes({0x0F, 0xB6, 0xC0}); }
+
+	// Emits a jump with an empty rel32 and returns its position
+	std::size_t Jump() {
+		code.push_back(0xE9);
+		Int32(0);
+		return Position() - 4;
+	}
+
+	std::size_t Jump(Condition condition) {
+		Bytes({0x0F, std::uint8_t(0x80 | condition)});
+		Int32(0);
+		return Position() - 4;
+	}
+
+  private:
+	void Access(std::uint8_t prefix, std::initializer_list<std::uint8_t> opcode, Register reg, Memory memory) {
+		if (prefix) {
+			code.push_back(prefix);
+		}
+		const bool variables = memory.base == Base::Variables;
+		if (variables) {
+			// REX.B selects r12
+			code.push_back(0x41);
+		}
+		code.insert(code.end(), opcode);
+		code.push_back(0x80 | reg << 3 | (variables ? 4 : 3));
+		if (variables) {
+			code.push_back(0x24);
+		}
+		Int32(memory.disp);
+	}
+};
+
+// Where a value of the simulated operand stack currently is
+struct Value {
+	enum class Kind { Constant, Variable, Slot };
+
+	Kind kind;
+	ValueType type;
+	// The int, or the bits of the double, of a constant
+	std::int64_t bits = 0;
+	// Variable slot or stack depth
+	std::size_t index = 0;
+};
+
+bool IsComparison(OperationType type) {
+	switch (type) {
+		case Lexeme::Less:
+		case Lexeme::LessEq:
+		case Lexeme::Greater:
+		case Lexeme::GreaterEq:
+		case Lexeme::Equal:
+		case Lexeme::NotEqual:
+			return true;
+		default:
+			return false;
+	}
+}
+
+Condition IntCondition(OperationType type) {
+	switch (type) {
+		case Lexeme::Less:
+			return kLess;
+		case Lexeme::LessEq:
+			return kLessEqual;
+		case Lexeme::Greater:
+			return kGreater;
+		case Lexeme::GreaterEq:
+			return kGreaterEqual;
+		case Lexeme::Equal:
+			return kEqual;
+		default:
+			return kNotEqual;
+	}
+}
+
+class LoopCompiler {
+  public:
+	LoopCompiler(const Program& program, const std::vector<int>& depths, OperationIndex start,
+				OperationIndex end, const std::unordered_map<VariableSlot, ValueType>& types);
+
+	// Returns false when some operation of the loop has no template
+	bool Compile();
+
+	const std::vector<std::uint8_t>& Code() const { return assembler_.code; }
+
+  private:
+	const Program& program_;
+	const std::vector<int>& depths_;
+	const OperationIndex start_;
+	const OperationIndex end_;
+	const std::unordered_map<VariableSlot, ValueType>& types_;
+	std::int32_t payload_offset_;
+
+	Assembler assembler_;
+	std::vector<Value> stack_;
+	bool live_ = true;
+	// Native offsets of the operations in the loop, indexed from start_
+	std::vector<std::size_t> labels_;
+	// Operand stack types wherever a jump lands
+	std::map<OperationIndex, std::vector<ValueType>> entry_types_;
+	std::vector<std::pair<std::size_t, OperationIndex>> jumps_;
+	std::vector<std::pair<std::size_t, OperationIndex>> exits_;
+
+	Memory VariableMemory(VariableSlot slot) const;
+	Memory StackMemory(std::size_t depth) const;
+
+	void LoadInt(const Value& value, Register reg);
+	void LoadReal(const Value& value, Register reg);
+	void Push(ValueType type);
+	Value Pop();
+	void Materialize();
+	void MaterializeVariable(VariableSlot slot);
+	std::vector<ValueType> StackTypes() const;
+
+	bool JumpTo(OperationIndex target, std::size_t position);
+	// Leaves to the interpreter at the start of the statement holding index
+	bool Bail(OperationIndex index, std::size_t position);
+
+	// Computes into eax or xmm0 and returns the result type through type
+	bool Binary(OperationType operation, const Value& op1, const Value& op2, OperationIndex index, ValueType& type);
+	bool Translate(OperationIndex index);
+};
+
+LoopCompiler::LoopCompiler(const Program& program, const std::vector<int>& depths, OperationIndex start,
+				OperationIndex end, const std::unordered_map<VariableSlot, ValueType>& types):
+	program_(program), depths_(depths), start_(start), end_(end), types_(types),
+	labels_(end - start + 1, 0) {
+	Variable probe;
+	payload_offset_ = static_cast<char*>(probe.value.Payload()) - reinterpret_cast<char*>(&probe);
+}
+
+Memory LoopCompiler::VariableMemory(VariableSlot slot) const {
+	return {Base::Variables, std::int32_t(slot * sizeof(Variable)) + payload_offset_};
+}
+
+Memory LoopCompiler::StackMemory(std::size_t depth) const {
+	return {Base::Stack, std::int32_t(depth * sizeof(std::int64_t))};
+}
+
+void LoopCompiler::LoadInt(const Value& value, Register reg) {
+	switch (value.kind) {
+		case Value::Kind::Constant:
+			assembler_.MoveInt(reg, std::int32_t(value.bits));
+			break;
+		case Value::Kind::Variable:
+			if (value.type == Logic) {
+				assembler_.LoadBool(reg, VariableMemory(value.index));
+			}
+			else {
+				assembler_.LoadInt(reg, VariableMemory(value.index));
+			}
+			break;
+		case Value::Kind::Slot:
+			assembler_.LoadInt(reg, StackMemory(value.index));
+			break;
+	}
+}
+
+void LoopCompiler::LoadReal(const Value& value, Register reg) {
+	if (value.type != Real) {
+		LoadInt(value, kA);
+		assembler_.IntToReal(reg);
+		return;
+	}
+	switch (value.kind) {
+		case Value::Kind::Constant:
+			assembler_.MoveReal(reg, value.bits);
+			break;
+		case Value::Kind::Variable:
+			assembler_.LoadReal(reg, VariableMemory(value.index));
+			break;
+		case Value::Kind::Slot:
+			assembler_.LoadReal(reg, StackMemory(value.index));
+			break;
+	}
+}
+
+// The result in eax or xmm0 becomes the top of the stack
+void LoopCompiler::Push(ValueType type) {
+	const std::size_t depth = stack_.size();
+	if (type == Real) {
+		assembler_.StoreReal(kA, StackMemory(depth));
+	}
+	else {
+		assembler_.StoreInt(kA, StackMemory(depth));
+	}
+	stack_.push_back({Value::Kind::Slot, type, 0, depth});
+}
+
+Value LoopCompiler::Pop() {
+	const Value value = stack_.back();
+	stack_.pop_back();
+	return value;
+}
+
+void LoopCompiler::Materialize() {
+	std::vector<Value> values;
+	values.swap(stack_);
+	for (const Value& value : values) {
+		if (value.kind == Value::Kind::Slot && value.index == stack_.size()) {
+			stack_.push_back(value);
+		}
+		else if (value.type == Real) {
+			LoadReal(value, kA);
+			Push(Real);
+		}
+		else {
+			LoadInt(value, kA);
+			Push(value.type);
+		}
+	}
+}
+
+// Values still reading a variable are copied before it is overwritten
+void LoopCompiler::MaterializeVariable(VariableSlot slot) {
+	for (const Value& value : stack_) {
+		if (value.kind == Value::Kind::Variable && value.index == slot) {
+			Materialize();
+			return;
+		}
+	}
+}
+
+std::vector<ValueType> LoopCompiler::StackTypes() const {
+	std::vector<ValueType> types;
+	for (const Value& value : stack_) {
+		types.push_back(value.type);
+	}
+	return types;
+}
+
+bool LoopCompiler::JumpTo(OperationIndex target, std::size_t position) {
+	if (target < start_ || target > end_) {
+		// The interpreter resumes there with an empty operand stack
+		if (!stack_.empty()) {
+			return false;
+		}
+		exits_.emplace_back(position, target);
+		return true;
+	}
+	if (labels_[target - start_] != 0) {
+		// Code already emitted for the target may keep values outside the native stack
+		if (depths_[target] != 0) {
+			return false;
+		}
+		jumps_.emplace_back(position, target);
+		return true;
+	}
+	const std::vector<ValueType> types = StackTypes();
+	const auto entry = entry_types_.find(target);
+	if (entry == entry_types_.end()) {
+		entry_types_.emplace(target, types);
+	}
+	else if (entry->second != types) {
+		return false;
+	}
+	jumps_.emplace_back(position, target);
+	return true;
+}
+
+bool LoopCompiler::Bail(OperationIndex index, std::size_t position) {
+	// Operations between the start of a statement and its store have no side effects
+	while (index > start_ && depths_[index] != 0) {
+		--index;
+	}
+	if (depths_[index] != 0) {
+		return false;
+	}
+	exits_.emplace_back(position, index);
+	return true;
+}
+
+bool LoopCompiler::Binary(OperationType operation, const Value& op1, const Value& op2, OperationIndex index,
+				ValueType& type) {
+	if (op1.type == Logic || op2.type == Logic || operation == Lexeme::And || operation == Lexeme::Or) {
+		return false;
+	}
+	if (op1.type == Int && op2.type == Int) {
+		LoadInt(op1, kA);
+		LoadInt(op2, kC);
+		type = Int;
+		switch (operation) {
+			case Lexeme::Add:
+				assembler_.AddInt();
+				return true;
+			case Lexeme::Sub:
+				assembler_.SubInt();
+				return true;
+			case Lexeme::Mul:
+				assembler_.MulInt();
+				return true;
+			case Lexeme::Div:
+			case Lexeme::Mod:
+				// Division by 0 or -1 is left to the interpreter, which raises or traps
+				assembler_.Test(kC);
+				if (!Bail(index, assembler_.Jump(kEqual))) {
+					return false;
+				}
+				assembler_.CompareMinusOne(kC);
+				if (!Bail(index, assembler_.Jump(kEqual))) {
+					return false;
+				}
+				assembler_.DivInt();
+				if (operation == Lexeme::Mod) {
+					assembler_.MoveRemainder();
+				}
+				return true;
+			default:
+				if (!IsComparison(operation)) {
+					return false;
+				}
+				assembler_.CompareInt();
+				assembler_.Set(IntCondition(operation), kA);
+				assembler_.ExtendBool();
+				type = Logic;
+				return true;
+		}
+	}
+
+	LoadReal(op1, kA);
+	LoadReal(op2, kC);
+	type = Real;
+	switch (operation) {
+		case Lexeme::Add:
+			assembler_.AddReal();
+			return true;
+		case Lexeme::Sub:
+			assembler_.SubReal();
+			return true;
+		case Lexeme::Mul:
+			assembler_.MulReal();
+			return true;
+		case Lexeme::Div:
+			assembler_.DivReal();
+			return true;
+		case Lexeme::Less:
+			assembler_.CompareReal(kC, kA);
+			assembler_.Set(kAbove, kA);
+			break;
+		case Lexeme::LessEq:
+			assembler_.CompareReal(kC, kA);
+			assembler_.Set(kAboveEqual, kA);
+			break;
+		case Lexeme::Greater:
+			assembler_.CompareReal(kA, kC);
+			assembler_.Set(kAbove, kA);
+			break;
+		case Lexeme::GreaterEq:
+			assembler_.CompareReal(kA, kC);
+			assembler_.Set(kAboveEqual, kA);
+			break;
+		case Lexeme::Equal:
+			// Unordered operands set ZF too
+			assembler_.CompareReal(kA, kC);
+			assembler_.Set(kEqual, kA);
+			assembler_.Set(kNoParity, kC);
+			assembler_.AndBool();
+			break;
+		case Lexeme::NotEqual:
+			assembler_.CompareReal(kA, kC);
+			assembler_.Set(kNotEqual, kA);
+			assembler_.Set(kParity, kC);
+			assembler_.OrBool();
+			break;
+		default:
+			return false;
+	}
+	assembler_.ExtendBool();
+	type = Logic;
+	return true;
+}
+
+bool LoopCompiler::Translate(OperationIndex index) {
+	const Instruction& instruction = program_.code[index];
+	switch (instruction.opcode) {
+		case Opcode::PushConst: {
+			const PolymorphicValue& constant = program_.constants[instruction.operand];
+			Value value{Value::Kind::Constant, constant.GetType()};
+			switch (constant.GetType()) {
+				case Int:
+				case Logic:
+					value.bits = int(constant);
+					break;
+				case Real: {
+					const double real = double(constant);
+					std::memcpy(&value.bits, &real, sizeof(real));
+					break;
+				}
+				default:
+					return false;
+			}
+			stack_.push_back(value);
+			return true;
+		}
+		case Opcode::Load:
+			stack_.push_back({Value::Kind::Variable, types_.at(instruction.operand), 0, instruction.operand});
+			return true;
+		case Opcode::Store: {
+			const Value value = Pop();
+			const ValueType type = types_.at(instruction.operand);
+			if (value.type != type) {
+				return false;
+			}
+			MaterializeVariable(instruction.operand);
+			if (type == Real) {
+				LoadReal(value, kA);
+				assembler_.StoreReal(kA, VariableMemory(instruction.operand));
+			}
+			else {
+				LoadInt(value, kA);
+				if (type == Logic) {
+					assembler_.StoreBool(kA, VariableMemory(instruction.operand));
+				}
+				else {
+					assembler_.StoreInt(kA, VariableMemory(instruction.operand));
+				}
+			}
+			return true;
+		}
+		case Opcode::AddOne: {
+			const Value value = Pop();
+			if (value.type == Real || types_.at(instruction.operand) != Int) {
+				return false;
+			}
+			MaterializeVariable(instruction.operand);
+			LoadInt(value, kA);
+			assembler_.IncrementInt();
+			assembler_.StoreInt(kA, VariableMemory(instruction.operand));
+			return true;
+		}
+		case Opcode::Go:
+			Materialize();
+			live_ = false;
+			return JumpTo(instruction.operand, assembler_.Jump());
+		case Opcode::If: {
+			const Value condition = Pop();
+			if (condition.type == Real) {
+				return false;
+			}
+			LoadInt(condition, kA);
+			assembler_.Test(kA);
+			// Moves leave the flags alone
+			Materialize();
+			return JumpTo(instruction.operand, assembler_.Jump(kEqual));
+		}
+		case Opcode::Binary:
+		case Opcode::TypedBinary:
+		case Opcode::ExecuteVariables: {
+			Value op1, op2;
+			if (instruction.opcode != Opcode::ExecuteVariables) {
+				op2 = Pop();
+				op1 = Pop();
+			}
+			else {
+				op1 = {Value::Kind::Variable, types_.at(instruction.operand), 0, instruction.operand};
+				op2 = {Value::Kind::Variable, types_.at(instruction.operand2), 0, instruction.operand2};
+			}
+			ValueType type;
+			if (!Binary(OperationType(instruction.aux), op1, op2, index, type)) {
+				return false;
+			}
+			Push(type);
+			return true;
+		}
+		case Opcode::ExecuteIf: {
+			const Value op2 = Pop();
+			const Value op1 = Pop();
+			ValueType type;
+			if (!Binary(OperationType(instruction.aux), op1, op2, index, type) || type == Real) {
+				return false;
+			}
+			assembler_.Test(kA);
+			Materialize();
+			return JumpTo(instruction.operand, assembler_.Jump(kEqual));
+		}
+		case Opcode::Not: {
+			const Value value = Pop();
+			if (value.type == Real) {
+				return false;
+			}
+			LoadInt(value, kA);
+			assembler_.Test(kA);
+			assembler_.Set(kEqual, kA);
+			assembler_.ExtendBool();
+			Push(Logic);
+			return true;
+		}
+		case Opcode::UnaryMinus: {
+			const Value value = Pop();
+			if (value.type == Logic) {
+				return false;
+			}
+			if (value.type == Real) {
+				LoadReal(value, kA);
+				assembler_.MoveReal(kC, std::int64_t(std::uint64_t(1) << 63));
+				assembler_.XorReal();
+				Push(Real);
+			}
+			else {
+				LoadInt(value, kA);
+				assembler_.NegateInt();
+				Push(Int);
+			}
+			return true;
+		}
+		case Opcode::Cast: {
+			const Value value = Pop();
+			switch (instruction.aux) {
+				case Lexeme::Bool:
+					if (value.type == Real) {
+						return false;
+					}
+					LoadInt(value, kA);
+					assembler_.Test(kA);
+					assembler_.Set(kNotEqual, kA);
+					assembler_.ExtendBool();
+					Push(Logic);
+					return true;
+				case Lexeme::Int:
+					if (value.type == Real) {
+						LoadReal(value, kA);
+						assembler_.RealToInt();
+					}
+					else {
+						LoadInt(value, kA);
+					}
+					Push(Int);
+					return true;
+				case Lexeme::Float:
+					LoadReal(value, kA);
+					Push(Real);
+					return true;
+				default:
+					return false;
+			}
+		}
+		case Opcode::ForRangeTest:
+		case Opcode::ForRangeNext: {
+			if (types_.at(instruction.operand2) != Int || types_.at(instruction.operand3) != Int) {
+				return false;
+			}
+			Materialize();
+			assembler_.LoadInt(kA, VariableMemory(instruction.operand2));
+			if (instruction.opcode == Opcode::ForRangeNext) {
+				assembler_.IncrementInt();
+				assembler_.StoreInt(kA, VariableMemory(instruction.operand2));
+			}
+			assembler_.CompareInt(kA, VariableMemory(instruction.operand3));
+			const Condition condition = instruction.opcode == Opcode::ForRangeNext ? kLess : kGreaterEqual;
+			return JumpTo(instruction.operand, assembler_.Jump(condition));
+		}
+		default:
+			return false;
+	}
+}
+
+bool LoopCompiler::Compile() {
+	if (depths_[start_] != 0) {
+		return false;
+	}
+	assembler_.Prologue();
+	entry_types_[start_] = {};
+
+	for (OperationIndex index = start_; index <= end_; ++index) {
+		labels_[index - start_] = assembler_.Position();
+		if (depths_[index] < 0) {
+			live_ = false;
+			continue;
+		}
+		const auto entry = entry_types_.find(index);
+		if (live_ && entry != entry_types_.end()) {
+			Materialize();
+			if (StackTypes() != entry->second) {
+				return false;
+			}
+		}
+		if (!live_) {
+			// Only reached by jumps, which have already been seen
+			if (entry == entry_types_.end()) {
+				return false;
+			}
+			stack_.clear();
+			for (ValueType type : entry->second) {
+				stack_.push_back({Value::Kind::Slot, type, 0, stack_.size()});
+			}
+		}
+		if (entry != entry_types_.end()) {
+			labels_[index - start_] = assembler_.Position();
+		}
+		live_ = true;
+		if (!Translate(index)) {
+			return false;
+		}
+	}
+	if (live_) {
+		Materialize();
+		if (!JumpTo(end_ + 1, assembler_.Jump())) {
+			return false;
+		}
+	}
+
+	for (const auto& jump : jumps_) {
+		assembler_.Patch(jump.first, labels_[jump.second - start_]);
+	}
+	std::map<OperationIndex, std::size_t> stubs;
+	for (const auto& exit : exits_) {
+		auto stub = stubs.find(exit.second);
+		if (stub == stubs.end()) {
+			stub = stubs.emplace(exit.second, assembler_.Position()).first;
+			assembler_.MoveInt(kA, std::int32_t(exit.second));
+			assembler_.Jump();
+		}
+		assembler_.Patch(exit.first, stub->second);
+	}
+	// Stubs end with a jump to the epilogue
+	const std::size_t epilogue = assembler_.Position();
+	for (const auto& stub : stubs) {
+		assembler_.Patch(stub.second + 6, epilogue);
+	}
+	assembler_.Epilogue();
+	return true;
+}
+
+// Operands that name a variable slot
+std::vector<VariableSlot> Slots(const Instruction& instruction) {
+	switch (instruction.opcode) {
+		case Opcode::Load:
+		case Opcode::Store:
+		case Opcode::AddOne:
+			return {instruction.operand};
+		case Opcode::ExecuteVariables:
+			return {instruction.operand, instruction.operand2};
+		case Opcode::ForRangeTest:
+		case Opcode::ForRangeNext:
+			return {instruction.operand2, instruction.operand3};
+		default:
+			return {};
+	}
+}
+
+} // namespace
+
+Jit::Jit(const Program& program): program_(program), depths_(StackDepths(program)),
+	stack_(MaxStackDepth(program) + 1) {}
+
+Jit::~Jit() {
+	for (auto& loop : loops_) {
+		if (loop.second.code) {
+			munmap(reinterpret_cast<void*>(loop.second.code), loop.second.code_size);
+		}
+	}
+}
+
+bool Jit::Compile(Loop& loop, OperationIndex head, OperationIndex back_edge, Context& context) {
+	std::unordered_map<VariableSlot, ValueType> types;
+	for (OperationIndex index = head; index <= back_edge; ++index) {
+		for (VariableSlot slot : Slots(program_.code[index])) {
+			const Variable& variable = context.variables[slot];
+			if (!variable.defined || variable.value.GetType() == Str) {
+				return false;
+			}
+			types.emplace(slot, variable.value.GetType());
+		}
+	}
+
+	LoopCompiler compiler(program_, depths_, head, back_edge, types);
+	if (!compiler.Compile()) {
+		return false;
+	}
+	const std::vector<std::uint8_t>& code = compiler.Code();
+	void* memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) {
+		return false;
+	}
+	std::memcpy(memory, code.data(), code.size());
+	if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+		munmap(memory, code.size());
+		return false;
+	}
+	loop.code = reinterpret_cast<NativeLoop>(memory);
+	loop.code_size = code.size();
+	loop.guards.assign(types.begin(), types.end());
+	return true;
+}
+
+bool Jit::Enter(OperationIndex head, OperationIndex back_edge, Context& context) {
+	Loop& loop = loops_[head];
+	if (loop.failed) {
+		return false;
+	}
+	if (!loop.code) {
+		if (++loop.hits < kHotLoop) {
+			return false;
+		}
+		if (!Compile(loop, head, back_edge, context)) {
+			loop.failed = true;
+			return false;
+		}
+	}
+	for (const auto& guard : loop.guards) {
+		const Variable& variable = context.variables[guard.first];
+		if (!variable.defined || variable.value.GetType() != guard.second) {
+			return false;
+		}
+	}
+	context.operation_index = loop.code(context.variables.data(), stack_.data());
+	return true;
+}
+
+#else
+
+// Other architectures always interpret
+
+Jit::Jit(const Program& program): program_(program) {}
+
+Jit::~Jit() {}
+
+bool Jit::Compile(Loop&, OperationIndex, OperationIndex, Context&) {
+	return false;
+}
+
+bool Jit::Enter(OperationIndex, OperationIndex, Context&) {
+	return false;
+}
+
+#endif
+
+std::size_t Jit::HotLoops() const {
+	std::size_t hot = 0;
+	for (const auto& loop : loops_) {
+		hot += loop.second.code || loop.second.failed;
+	}
+	return hot;
+}
+
+std::size_t Jit::CompiledLoops() const {
+	std::size_t compiled = 0;
+	for (const auto& loop : loops_) {
+		compiled += loop.second.code != nullptr;
+	}
+	return compiled;
+}
+
+} // namespace execution
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+
+namespace execution {
+
+// Template JIT for the loops of a bytecode program. A loop that only works on
+// ints, floats and bools is compiled to x86-64 once its back edge is hot and is
+// run natively while its variables keep the types it was compiled for. Anything
+// else, including integer division by zero, is left to the interpreter.
+class Jit {
+  public:
+	// Taken back edges before a loop is compiled
+	static const std::size_t kHotLoop = 100;
+
+	explicit Jit(const Program& program);
+	Jit(const Jit&) = delete;
+	Jit& operator=(const Jit&) = delete;
+	~Jit();
+
+	// Called on a taken back edge to head. Returns true when the loop was run
+	// natively; the operation index is then where the interpreter resumes.
+	bool Enter(OperationIndex head, OperationIndex back_edge, Context& context);
+
+	std::size_t HotLoops() const;
+	std::size_t CompiledLoops() const;
+
+  private:
+	// Takes the variables and a scratch operand stack, returns the index to resume at
+	using NativeLoop = std::uint64_t (*)(Variable* variables, std::int64_t* stack);
+
+	struct Loop {
+		std::size_t hits = 0;
+		bool failed = false;
+		NativeLoop code = nullptr;
+		std::size_t code_size = 0;
+		// Every variable the loop touches with the type it was compiled for
+		std::vector<std::pair<VariableSlot, ValueType>> guards;
+	};
+
+	const Program& program_;
+	std::vector<int> depths_;
+	std::vector<std::int64_t> stack_;
+	std::unordered_map<OperationIndex, Loop> loops_;
+
+	bool Compile(Loop& loop, OperationIndex head, OperationIndex back_edge, Context& context);
+};
+
+} // namespace execution
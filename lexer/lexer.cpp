@@ -1,10 +1,12 @@
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 
 #include "../base_files/operators.hpp"
 #include "../base_files/lexemes.hpp"
+#include "scan.hpp"
 #include "lexer.hpp"
 
 int Lexer::GetLine() const {
@@ -14,11 +16,29 @@ int Lexer::GetPos() const {
 	return pos_;
 }
 
+inline Lexer::Char Lexer::Get() {
+	if (cursor_ == end_) {
+		exhausted_ = true;
+		return std::istream::traits_type::eof();
+	}
+	return static_cast<unsigned char>(*cursor_++);
+}
+
 void Lexer::Unget() {
-	input_.unget();
+	// Nothing to put back once the end was read
+	if (!exhausted_) {
+		--cursor_;
+	}
 	pos_--;
 }
 
+inline const char* Lexer::Take(std::size_t count) {
+	const char* start = cursor_;
+	cursor_ += count;
+	pos_ += count;
+	return start;
+}
+
 inline bool Lexer::IsVar(Char c) {
 	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
 }
@@ -76,7 +96,17 @@ const std::unordered_map<std::string, Lexeme::LexemeType> Lexer::ReservedWords {
 };
 
 Lexer::Lexer(std::istream& input):
-	input_(input),
+	buffer_(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()),
+	cursor_(buffer_.data()),
+	end_(buffer_.data() + buffer_.size()),
+	scan_(&ActiveScanKernels()),
+	has_lexeme_(false),
+	state_(nullptr){}
+
+Lexer::Lexer(const char* data, std::size_t size):
+	cursor_(data),
+	end_(data + size),
+	scan_(&ActiveScanKernels()),
 	has_lexeme_(false),
 	state_(nullptr){}
 
@@ -84,7 +114,7 @@ bool Lexer::HasLexeme() {
 	if (has_lexeme_) {
 		return true;
 	}
-	if (!input_) {
+	if (exhausted_) {
 		return false;
 	}
 
@@ -95,7 +125,7 @@ bool Lexer::HasLexeme() {
 	lexeme_.value.clear();
 	Char c;
 	do {
-		c = input_.get();
+		c = Get();
 		pos_++;
 		if ((this->*state_)(c)) {
 			has_lexeme_ = true;
@@ -123,7 +153,10 @@ Lexeme Lexer::TakeLexeme() {
 
 bool Lexer::LineStart(Lexer::Char c) {
 	if (c == ' ') {
-		lexeme_.indent_amount++;
+		// The rest of the indentation at once
+		const std::size_t rest = scan_->spaces(cursor_, end_);
+		Take(rest);
+		lexeme_.indent_amount += 1 + static_cast<int>(rest);
 		return false;
 	}
 
@@ -290,7 +323,7 @@ bool Lexer::Zero(Lexer::Char c) {
 	}
 	if (c == '0') {
 		pos_++;
-		c = input_.get();
+		c = Get();
 		return false;
 	}
 	lexeme_.type = Lexeme::IntegerConst;
@@ -363,6 +396,8 @@ bool Lexer::FullEFloat(Char c) {
 bool Lexer::Variable(Lexer::Char c) {
 	if (IsVar(c) || (c >= '0' && c <= '9')) {
 		lexeme_.value.push_back(c);
+		const std::size_t rest = scan_->identifier(cursor_, end_);
+		lexeme_.value.append(Take(rest), rest);
 		return false;
 	}
 
@@ -394,6 +429,8 @@ bool Lexer::String(Lexer::Char c) {
 
 	if (c != '\n' && c != std::istream::traits_type::eof() && IsRelevant(c)) {
 		lexeme_.value.push_back(c);
+		const std::size_t rest = scan_->string(cursor_, end_, lexeme_.value[0]);
+		lexeme_.value.append(Take(rest), rest);
 		return false;
 	}
 
@@ -416,6 +453,8 @@ bool Lexer::LineComments(Lexer::Char c) {
 	if (c == '\n' || c == std::istream::traits_type::eof()) {
 		Unget();
 		state_ = &Lexer::LineStart;
+		return false;
 	}
+	Take(scan_->line(cursor_, end_));
 	return false;
 }
\ No newline at end of file
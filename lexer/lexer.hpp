@@ -1,15 +1,20 @@
 #pragma once
 
+#include <cstddef>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 
 #include "../base_files/operators.hpp"
+#include "scan.hpp"
 
 class Lexer {
   public:
+	// Reads the whole stream into a buffer of its own first
 	explicit Lexer(std::istream& input);
+	// Scans size bytes at data, which must outlive the lexer
+	Lexer(const char* data, std::size_t size);
 
 	int GetLine() const;
 	int GetPos() const;
@@ -25,9 +30,19 @@ class Lexer {
 	int line_ = 1;
 	int pos_ = 0;
 
-	std::istream& input_;
+	// Contents of a stream the lexer was given
+	std::string buffer_;
+	const char* cursor_;
+	const char* end_;
+	// Set once the end was read, like the failbit of a stream
+	bool exhausted_ = false;
 
+	Char Get();
 	void Unget();
+	// Moves past count more bytes of a run and returns where they start
+	const char* Take(std::size_t count);
+
+	const ScanKernels* scan_;
 
 	bool Initial(Char c);
 
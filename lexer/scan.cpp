@@ -0,0 +1,205 @@
+#include <cstddef>
+#include <string>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "scan.hpp"
+
+namespace {
+
+// A run kind says which bytes continue the run: one at a time for the scalar
+// loops and the tails, and as a mask of whole vectors for the SSE2 and AVX2 loops
+
+#if defined(__x86_64__)
+
+// Bytes within [low, high]; SSE2 only compares signed, so shift the range to start at -128
+inline __m128i InRange(__m128i bytes, char low, char high) {
+	const __m128i shifted = _mm_add_epi8(bytes, _mm_set1_epi8(static_cast<char>(-128 - low)));
+	return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(high - low - 127)));
+}
+
+__attribute__((target("avx2"))) inline __m256i InRange(__m256i bytes, char low, char high) {
+	const __m256i shifted = _mm256_add_epi8(bytes, _mm256_set1_epi8(static_cast<char>(-128 - low)));
+	return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(high - low - 127)), shifted);
+}
+
+#endif
+
+struct Spaces {
+	bool Continues(unsigned char c) const {
+		return c == ' ';
+	}
+#if defined(__x86_64__)
+	__m128i Continues(__m128i bytes) const {
+		return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+	}
+	__attribute__((target("avx2"))) __m256i Continues(__m256i bytes) const {
+		return _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+	}
+#endif
+};
+
+struct Line {
+	bool Continues(unsigned char c) const {
+		return c != '\n';
+	}
+#if defined(__x86_64__)
+	__m128i Continues(__m128i bytes) const {
+		return _mm_xor_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), _mm_set1_epi8(-1));
+	}
+	__attribute__((target("avx2"))) __m256i Continues(__m256i bytes) const {
+		return _mm256_xor_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')), _mm256_set1_epi8(-1));
+	}
+#endif
+};
+
+struct Identifier {
+	bool Continues(unsigned char c) const {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+#if defined(__x86_64__)
+	// Setting bit 5 folds upper case onto lower case and moves no other byte into a-z
+	__m128i Continues(__m128i bytes) const {
+		const __m128i letters = InRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+		const __m128i digits = InRange(bytes, '0', '9');
+		return _mm_or_si128(_mm_or_si128(letters, digits), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('_')));
+	}
+	__attribute__((target("avx2"))) __m256i Continues(__m256i bytes) const {
+		const __m256i letters = InRange(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20)), 'a', 'z');
+		const __m256i digits = InRange(bytes, '0', '9');
+		return _mm256_or_si256(_mm256_or_si256(letters, digits), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('_')));
+	}
+#endif
+};
+
+struct StringBody {
+	char quote;
+
+	bool Continues(unsigned char c) const {
+		return ((c >= 32 && c <= 127) || c == '\t') && c != static_cast<unsigned char>(quote) && c != '\\';
+	}
+#if defined(__x86_64__)
+	__m128i Continues(__m128i bytes) const {
+		const __m128i relevant = _mm_or_si128(InRange(bytes, 32, 127), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t')));
+		const __m128i ends = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(quote)),
+			_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+		return _mm_andnot_si128(ends, relevant);
+	}
+	__attribute__((target("avx2"))) __m256i Continues(__m256i bytes) const {
+		const __m256i relevant = _mm256_or_si256(InRange(bytes, 32, 127),
+			_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t')));
+		const __m256i ends = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(quote)),
+			_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\')));
+		return _mm256_andnot_si256(ends, relevant);
+	}
+#endif
+};
+
+template <typename Run>
+std::size_t ScalarSpan(const char* begin, const char* end, const Run& run) {
+	const char* cursor = begin;
+	while (cursor != end && run.Continues(static_cast<unsigned char>(*cursor))) {
+		++cursor;
+	}
+	return cursor - begin;
+}
+
+#if defined(__x86_64__)
+
+// Whole vectors only, the bytes past end may not be mapped
+template <typename Run>
+std::size_t Sse2Span(const char* begin, const char* end, const Run& run) {
+	const char* cursor = begin;
+	for (; end - cursor >= 16; cursor += 16) {
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+		const unsigned stops = ~_mm_movemask_epi8(run.Continues(bytes)) & 0xFFFF;
+		if (stops != 0) {
+			return cursor - begin + __builtin_ctz(stops);
+		}
+	}
+	return cursor - begin + ScalarSpan(cursor, end, run);
+}
+
+template <typename Run>
+__attribute__((target("avx2"))) std::size_t Avx2Span(const char* begin, const char* end, const Run& run) {
+	const char* cursor = begin;
+	for (; end - cursor >= 32; cursor += 32) {
+		const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cursor));
+		const unsigned stops = ~static_cast<unsigned>(_mm256_movemask_epi8(run.Continues(bytes)));
+		if (stops != 0) {
+			return cursor - begin + __builtin_ctz(stops);
+		}
+	}
+	return cursor - begin + Sse2Span(cursor, end, run);
+}
+
+#endif
+
+const ScanKernels kScalar = {
+	"scalar",
+	[](const char* begin, const char* end) { return ScalarSpan(begin, end, Spaces()); },
+	[](const char* begin, const char* end) { return ScalarSpan(begin, end, Line()); },
+	[](const char* begin, const char* end) { return ScalarSpan(begin, end, Identifier()); },
+	[](const char* begin, const char* end, char quote) { return ScalarSpan(begin, end, StringBody{quote}); },
+};
+
+#if defined(__x86_64__)
+
+const ScanKernels kSse2 = {
+	"sse2",
+	[](const char* begin, const char* end) { return Sse2Span(begin, end, Spaces()); },
+	[](const char* begin, const char* end) { return Sse2Span(begin, end, Line()); },
+	[](const char* begin, const char* end) { return Sse2Span(begin, end, Identifier()); },
+	[](const char* begin, const char* end, char quote) { return Sse2Span(begin, end, StringBody{quote}); },
+};
+
+const ScanKernels kAvx2 = {
+	"avx2",
+	[](const char* begin, const char* end) { return Avx2Span(begin, end, Spaces()); },
+	[](const char* begin, const char* end) { return Avx2Span(begin, end, Line()); },
+	[](const char* begin, const char* end) { return Avx2Span(begin, end, Identifier()); },
+	[](const char* begin, const char* end, char quote) { return Avx2Span(begin, end, StringBody{quote}); },
+};
+
+// SSE2 is part of x86-64 itself. Runs during static initialization, perhaps ahead of
+// the runtime's own CPU detection
+const ScanKernels* Widest() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") ? &kAvx2 : &kSse2;
+}
+
+#else
+
+const ScanKernels* Widest() {
+	return &kScalar;
+}
+
+#endif
+
+const ScanKernels* active = Widest();
+
+} // namespace
+
+const ScanKernels& ActiveScanKernels() {
+	return *active;
+}
+
+bool SelectScanKernels(const std::string& name) {
+	if (name == kScalar.name) {
+		active = &kScalar;
+		return true;
+	}
+#if defined(__x86_64__)
+	if (name == kSse2.name) {
+		active = &kSse2;
+		return true;
+	}
+	if (name == kAvx2.name && __builtin_cpu_supports("avx2")) {
+		active = &kAvx2;
+		return true;
+	}
+#endif
+	return false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Skips the runs of bytes the lexer would otherwise take one state call each
+// for. Every kernel returns the length of the run at the start of [begin, end)
+struct ScanKernels {
+	// "scalar", "sse2" or "avx2"
+	const char* name;
+	// Spaces, as in indentation
+	std::size_t (*spaces)(const char* begin, const char* end);
+	// Anything but a newline, as in a comment
+	std::size_t (*line)(const char* begin, const char* end);
+	// Letters, digits and underscores
+	std::size_t (*identifier)(const char* begin, const char* end);
+	// Printable ASCII and tabs other than the quote and the backslash
+	std::size_t (*string)(const char* begin, const char* end, char quote);
+};
+
+// The widest kernels this CPU runs, unless SelectScanKernels picked others
+const ScanKernels& ActiveScanKernels();
+
+// Switches to the kernels with this name; false when the CPU cannot run them
+bool SelectScanKernels(const std::string& name);
@@ -0,0 +1,52 @@
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.hpp"
+
+SourceFile::SourceFile(const std::string& path) {
+	const int descriptor = open(path.c_str(), O_RDONLY);
+	struct stat status;
+	if (descriptor >= 0 && fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+		void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if (mapping != MAP_FAILED) {
+			// The lexer reads front to back once
+			madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+			mapping_ = mapping;
+			size_ = status.st_size;
+		}
+	}
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+	if (mapping_) {
+		return;
+	}
+	// Empty files, pipes and file systems without mmap
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("Error: cannot read file " + path);
+	}
+	contents_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+	size_ = contents_.size();
+}
+
+SourceFile::~SourceFile() {
+	if (mapping_) {
+		munmap(mapping_, size_);
+	}
+}
+
+const char* SourceFile::Data() const {
+	return mapping_ ? static_cast<const char*>(mapping_) : contents_.data();
+}
+
+std::size_t SourceFile::Size() const {
+	return size_;
+}
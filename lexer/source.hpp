@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// The contents of a file in one contiguous block: mapped read-only, or read into
+// memory where the file cannot be mapped
+class SourceFile {
+  public:
+	explicit SourceFile(const std::string& path);
+	~SourceFile();
+
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+	const char* Data() const;
+	std::size_t Size() const;
+
+  private:
+	void* mapping_ = nullptr;
+	std::size_t size_ = 0;
+	std::string contents_;
+};
@@ -0,0 +1,332 @@
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "optimizer.hpp"
+
+namespace execution {
+
+namespace {
+
+// Longer strings are cheaper to build at run time than to keep in the pool
+const std::size_t kMaxFoldedString = 1024;
+
+struct Entry {
+	OperationIndex origin;
+	std::shared_ptr<Operation> operation;
+	Instruction instruction;
+	Location location;
+};
+
+std::vector<bool> JumpTargets(const Program& program) {
+	std::vector<bool> targets(program.code.size() + 1, false);
+	for (const Instruction& instruction : program.code) {
+		if (IsJump(instruction.opcode)) {
+			targets[instruction.operand] = true;
+		}
+	}
+	return targets;
+}
+
+// Jumps are rebuilt since their targets move when operations are removed
+std::shared_ptr<Operation> Retarget(const Entry& entry, OperationIndex target) {
+	const Instruction& instruction = entry.instruction;
+	const Location& location = entry.location;
+	switch (instruction.opcode) {
+		case Opcode::Go:
+			return std::make_shared<GoOperation>(target);
+		case Opcode::If:
+			return std::make_shared<IfOperation>(target);
+		case Opcode::ExecuteIf:
+			return std::make_shared<ExecuteIfOperation>(
+				ExecuteOperation(OperationType(instruction.aux), location.pos, location.line), target);
+		case Opcode::ForRangeTest:
+			return std::make_shared<ForRangeTestOperation>(
+				target, instruction.operand2, instruction.operand3, location.pos, location.line);
+		case Opcode::ForRangeNext:
+			return std::make_shared<ForRangeNextOperation>(
+				target, instruction.operand2, instruction.operand3, location.pos, location.line);
+		default:
+			return entry.operation;
+	}
+}
+
+// Replaces the operations with the result; removed operations hand their incoming jumps to the next surviving one
+std::size_t Rebuild(Operations& operations, const std::vector<Entry>& result) {
+	std::vector<OperationIndex> remap(operations.size() + 1);
+	std::size_t position = 0;
+	for (OperationIndex index = 0; index < remap.size(); ++index) {
+		while (position < result.size() && result[position].origin < index) {
+			++position;
+		}
+		remap[index] = position;
+	}
+
+	const std::size_t removed = operations.size() - result.size();
+	operations.clear();
+	for (const Entry& entry : result) {
+		if (IsJump(entry.instruction.opcode)) {
+			operations.push_back(Retarget(entry, remap[entry.instruction.operand]));
+		}
+		else {
+			operations.push_back(entry.operation);
+		}
+	}
+	return removed;
+}
+
+std::size_t Arity(const Instruction& instruction) {
+	switch (instruction.opcode) {
+		case Opcode::Binary:
+			return 2;
+		case Opcode::UnaryMinus:
+		case Opcode::Not:
+		case Opcode::Cast:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// Integer division by zero (or of INT_MIN by -1) traps instead of raising, so it is never folded
+bool MayTrap(const Instruction& instruction, PolymorphicValue divisor) {
+	if (instruction.opcode != Opcode::Binary ||
+		(instruction.aux != Lexeme::Div && instruction.aux != Lexeme::Mod)) {
+		return false;
+	}
+	if (divisor.GetType() != Int && divisor.GetType() != Logic) {
+		return false;
+	}
+	return int(divisor) == 0 || int(divisor) == -1;
+}
+
+bool ProducesBool(const Instruction& instruction) {
+	switch (instruction.opcode) {
+		case Opcode::Not:
+			return true;
+		case Opcode::Binary:
+			switch (instruction.aux) {
+				case Lexeme::Less:
+				case Lexeme::LessEq:
+				case Lexeme::Greater:
+				case Lexeme::GreaterEq:
+				case Lexeme::Equal:
+				case Lexeme::NotEqual:
+				case Lexeme::And:
+				case Lexeme::Or:
+					return true;
+				default:
+					return false;
+			}
+		default:
+			return instruction.opcode == Opcode::Cast && instruction.aux == Lexeme::Bool;
+	}
+}
+
+bool IsConstant(const Entry& entry) {
+	return entry.instruction.opcode == Opcode::PushConst;
+}
+
+bool Fold(std::vector<Entry>& result, const Entry& entry, const std::vector<bool>& targets,
+			std::vector<PolymorphicValue>& constants) {
+	const std::size_t arity = Arity(entry.instruction);
+	if (arity == 0 || result.size() < arity) {
+		return false;
+	}
+	const std::size_t first = result.size() - arity;
+	for (std::size_t i = first; i < result.size(); ++i) {
+		if (!IsConstant(result[i]) || (i != first && targets[result[i].origin])) {
+			return false;
+		}
+	}
+	if (MayTrap(entry.instruction, constants[result.back().instruction.operand])) {
+		return false;
+	}
+
+	Context scratch;
+	scratch.stack.Reserve(arity);
+	for (std::size_t i = first; i < result.size(); ++i) {
+		scratch.stack.emplace(constants[result[i].instruction.operand]);
+	}
+	try {
+		entry.operation->Do(scratch);
+	} catch (const std::exception&) {
+		return false;
+	}
+	const PolymorphicValue value = scratch.stack.top().Get();
+	if (value.GetType() == Str && value.GetString().size() > kMaxFoldedString) {
+		return false;
+	}
+
+	const OperationIndex origin = result[first].origin;
+	result.resize(first);
+	constants.push_back(value);
+	const ConstantIndex index = constants.size() - 1;
+	result.push_back({origin, std::make_shared<ValueOperation>(index), {Opcode::PushConst, 0, std::uint32_t(index)}, {}});
+	return true;
+}
+
+// Returns true when the entry was absorbed into the tail of the result
+bool Simplify(std::vector<Entry>& result, const Entry& entry, const std::vector<bool>& targets,
+			std::vector<PolymorphicValue>& constants) {
+	if (Fold(result, entry, targets, constants)) {
+		return true;
+	}
+	const Instruction& instruction = entry.instruction;
+	if (instruction.opcode == Opcode::Go && instruction.operand == entry.origin + 1) {
+		return true;
+	}
+	if (result.empty()) {
+		return false;
+	}
+
+	Entry& last = result.back();
+	switch (instruction.opcode) {
+		case Opcode::Not:
+			// not not x is bool(x)
+			if (last.instruction.opcode == Opcode::Not) {
+				last.operation = std::make_shared<BoolCast>();
+				last.instruction = {Opcode::Cast, Lexeme::Bool, 0};
+				return true;
+			}
+			return false;
+		case Opcode::Cast:
+			if (instruction.aux == Lexeme::Bool && ProducesBool(last.instruction)) {
+				return true;
+			}
+			return last.instruction.opcode == Opcode::Cast && last.instruction.aux == instruction.aux;
+		case Opcode::If:
+			// The condition is tested for truth anyway
+			if (last.instruction.opcode == Opcode::Cast && last.instruction.aux == Lexeme::Bool) {
+				result.pop_back();
+				return false;
+			}
+			if (IsConstant(last)) {
+				const bool truth = bool(constants[last.instruction.operand]);
+				const OperationIndex origin = last.origin;
+				result.pop_back();
+				if (!truth) {
+					result.push_back({origin, nullptr, {Opcode::Go, 0, instruction.operand}, {}});
+				}
+				return true;
+			}
+			return false;
+		default:
+			return false;
+	}
+}
+
+// for ... in range compiles to
+//   h: load i; load edge; less; if exit
+//      body
+//      load i; add one i; go h
+//   exit:
+// Returns the loop head h when the go at index is the tail of such a loop
+bool IsForRangeTail(const Program& program, OperationIndex index, OperationIndex& head) {
+	const std::vector<Instruction>& code = program.code;
+	if (code[index].opcode != Opcode::Go || code[index].operand + 6 > index) {
+		return false;
+	}
+	head = code[index].operand;
+	const std::uint32_t counter = code[head].operand;
+	return code[head].opcode == Opcode::Load &&
+		code[head + 1].opcode == Opcode::Load &&
+		code[head + 2].opcode == Opcode::Binary && code[head + 2].aux == Lexeme::Less &&
+		code[head + 3].opcode == Opcode::If && code[head + 3].operand == index + 1 &&
+		code[index - 2].opcode == Opcode::Load && code[index - 2].operand == counter &&
+		code[index - 1].opcode == Opcode::AddOne && code[index - 1].operand == counter;
+}
+
+// Returns true when the entry was fused into the tail of the result
+bool FuseTail(std::vector<Entry>& result, const Entry& entry, const std::vector<bool>& targets,
+			const std::vector<VariableName>& variables) {
+	if (result.empty()) {
+		return false;
+	}
+	const Instruction& instruction = entry.instruction;
+	Entry& last = result.back();
+	const Location& location = entry.location;
+
+	if (instruction.opcode == Opcode::Binary && result.size() >= 2 && !targets[last.origin]) {
+		Entry& first = result[result.size() - 2];
+		if (first.instruction.opcode != Opcode::Load || last.instruction.opcode != Opcode::Load) {
+			return false;
+		}
+		const VariableSlot slot1 = first.instruction.operand;
+		const VariableSlot slot2 = last.instruction.operand;
+		first.operation = std::make_shared<ExecuteVariablesOperation>(
+			VariableOperation(variables[slot1], slot1, first.location.pos, first.location.line),
+			VariableOperation(variables[slot2], slot2, last.location.pos, last.location.line),
+			ExecuteOperation(OperationType(instruction.aux), location.pos, location.line));
+		first.instruction = {Opcode::ExecuteVariables, instruction.aux, std::uint32_t(slot1), std::uint32_t(slot2)};
+		first.location = location;
+		result.pop_back();
+		return true;
+	}
+	if (instruction.opcode == Opcode::If && last.instruction.opcode == Opcode::Binary) {
+		last.instruction = {Opcode::ExecuteIf, last.instruction.aux, instruction.operand};
+		return true;
+	}
+	return false;
+}
+
+} // namespace
+
+std::size_t Optimize(Operations& operations, std::vector<PolymorphicValue>& constants) {
+	const Program program = Compile(operations, {}, constants);
+	const std::vector<bool> targets = JumpTargets(program);
+
+	std::vector<Entry> result;
+	for (OperationIndex index = 0; index < operations.size(); ++index) {
+		const Entry entry{index, operations[index], program.code[index], program.locations[index]};
+		if (targets[index] || !Simplify(result, entry, targets, constants)) {
+			result.push_back(entry);
+		}
+	}
+	return Rebuild(operations, result);
+}
+
+std::size_t Fuse(Operations& operations, const std::vector<VariableName>& variables) {
+	const Program program = Compile(operations, variables, {});
+	const std::vector<bool> targets = JumpTargets(program);
+
+	std::vector<Entry> entries;
+	for (OperationIndex index = 0; index < operations.size(); ++index) {
+		entries.push_back({index, operations[index], program.code[index], program.locations[index]});
+	}
+
+	// Range loops span their body, so they are fused before the local sequences
+	std::vector<bool> fused(operations.size(), false);
+	for (OperationIndex index = 0; index < operations.size(); ++index) {
+		OperationIndex head;
+		if (!IsForRangeTail(program, index, head)) {
+			continue;
+		}
+		const std::uint32_t counter = program.code[head].operand;
+		const std::uint32_t bound = program.code[head + 1].operand;
+		const Location& location = program.locations[head + 2];
+		entries[head].instruction = {Opcode::ForRangeTest, 0, std::uint32_t(index + 1), counter, bound};
+		entries[head].location = location;
+		entries[index - 2].instruction = {Opcode::ForRangeNext, 0, std::uint32_t(head + 4), counter, bound};
+		entries[index - 2].location = location;
+		fused[head + 1] = fused[head + 2] = fused[head + 3] = true;
+		fused[index - 1] = fused[index] = true;
+	}
+
+	std::vector<Entry> result;
+	for (OperationIndex index = 0; index < operations.size(); ++index) {
+		if (fused[index]) {
+			continue;
+		}
+		if (targets[index] || !FuseTail(result, entries[index], targets, variables)) {
+			result.push_back(entries[index]);
+		}
+	}
+	return Rebuild(operations, result);
+}
+
+} // namespace execution
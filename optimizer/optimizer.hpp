@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+
+namespace execution {
+
+// Folds constant subexpressions, collapses redundant casts (including bool() of a
+// comparison) and double negations
+// and drops no-op jumps. Folding that would raise is left for run time.
+// New constants are appended to the pool; returns the number of removed operations.
+std::size_t Optimize(Operations& operations, std::vector<PolymorphicValue>& constants);
+
+// Replaces range loop heads and tails, load; load; binop and binop; if with fused
+// superinstructions. Returns the number of removed operations.
+std::size_t Fuse(Operations& operations, const std::vector<VariableName>& variables);
+
+} // namespace execution
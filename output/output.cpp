@@ -0,0 +1,115 @@
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "output.hpp"
+
+namespace execution {
+
+namespace {
+
+// Writes every iovec, retrying after short writes and interrupts.
+// Errors are dropped like a failed std::cout write would be.
+void WriteAll(int fd, iovec* parts, int count) {
+	while (count > 0) {
+		ssize_t written = writev(fd, parts, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		while (count > 0 && std::size_t(written) >= parts->iov_len) {
+			written -= parts->iov_len;
+			++parts;
+			--count;
+		}
+		if (count > 0) {
+			parts->iov_base = static_cast<char*>(parts->iov_base) + written;
+			parts->iov_len -= written;
+		}
+	}
+}
+
+void FlushAndDie(int signal) {
+	Stdout().Flush();
+	std::signal(signal, SIG_DFL);
+	std::raise(signal);
+}
+
+} // namespace
+
+Output::Output(int fd): fd_(fd), buffer_(kCapacity) {}
+
+Output::~Output() {
+	Flush();
+}
+
+void Output::SetPolicy(FlushPolicy policy) {
+	policy_ = policy;
+}
+
+void Output::Write(const char* data, std::size_t size) {
+	if (size_ + size > buffer_.size()) {
+		// The buffered part and the new data go out in one syscall
+		iovec parts[] = {{buffer_.data(), size_}, {const_cast<char*>(data), size}};
+		WriteAll(fd_, parts, 2);
+		size_ = 0;
+		return;
+	}
+	std::memcpy(buffer_.data() + size_, data, size);
+	size_ += size;
+	if (policy_ == FlushPolicy::Unbuffered) {
+		Flush();
+	}
+}
+
+void Output::Write(const std::string& str) {
+	Write(str.data(), str.size());
+}
+
+void Output::Write(const char* str) {
+	Write(str, std::strlen(str));
+}
+
+void Output::Write(char c) {
+	Write(&c, 1);
+}
+
+void Output::EndLine() {
+	Write('\n');
+	if (policy_ == FlushPolicy::Line) {
+		Flush();
+	}
+}
+
+void Output::Flush() {
+	if (size_ == 0) {
+		return;
+	}
+	iovec part = {buffer_.data(), size_};
+	WriteAll(fd_, &part, 1);
+	size_ = 0;
+}
+
+Output& Stdout() {
+	static Output output(STDOUT_FILENO);
+	return output;
+}
+
+FlushPolicy DefaultPolicy(int fd) {
+	return isatty(fd) ? FlushPolicy::Line : FlushPolicy::Full;
+}
+
+void FlushOnFatalSignals() {
+	Stdout();
+	std::signal(SIGFPE, FlushAndDie);
+	std::signal(SIGSEGV, FlushAndDie);
+}
+
+} // namespace execution
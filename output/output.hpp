@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace execution {
+
+enum class FlushPolicy {
+	Line,        // after every line, for terminals
+	Full,        // when the buffer fills up, for pipes and files
+	Unbuffered,  // after every write
+};
+
+// Buffered writer over a file descriptor, written with as few syscalls as possible
+class Output {
+  public:
+	static const std::size_t kCapacity = 64 * 1024;
+
+	explicit Output(int fd);
+	Output(const Output&) = delete;
+	Output& operator=(const Output&) = delete;
+	~Output();
+
+	void SetPolicy(FlushPolicy policy);
+
+	void Write(const char* data, std::size_t size);
+	void Write(const std::string& str);
+	void Write(const char* str);
+	void Write(char c);
+	// Ends the line, flushing it when the policy asks for it
+	void EndLine();
+	void Flush();
+
+  private:
+	int fd_;
+	FlushPolicy policy_ = FlushPolicy::Full;
+	std::vector<char> buffer_;
+	std::size_t size_ = 0;
+};
+
+// Output of the interpreted program
+Output& Stdout();
+
+// Line buffered on a terminal, fully buffered otherwise
+FlushPolicy DefaultPolicy(int fd);
+
+// Makes SIGFPE and SIGSEGV flush Stdout() before the process dies
+void FlushOnFatalSignals();
+
+} // namespace execution
@@ -10,12 +10,15 @@
 
 #include "../lexer/lexer.hpp"
 #include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
 #include "parser.hpp"
 
 using namespace execution;
 
 Parser::Parser(std::istream& input): lexer_(input), indents({0}) {}
 
+Parser::Parser(const char* data, std::size_t size): lexer_(data, size), indents({0}) {}
+
 void Parser::Run() {
 	while (lexer_.HasLexeme() && lexer_.PeekLexeme().type == Lexeme::EOL) {
 		lexer_.TakeLexeme();
@@ -42,6 +45,27 @@ void Parser::Run() {
 			next_block_indent = Block();
 		}
 	}
+	// Also rejects operations whose stack effects do not balance
+	max_stack_depth = MaxStackDepth(Compile(operations, variables, constants));
+}
+
+VariableSlot Parser::Resolve(const VariableName& name) {
+	auto slot = slots_.find(name);
+	if (slot != slots_.end()) {
+		return slot->second;
+	}
+	variables.push_back(name);
+	return slots_[name] = variables.size() - 1;
+}
+
+void Parser::PushConstant(const std::string& value, Lexeme::LexemeType type) {
+	auto key = std::make_pair(type, value);
+	auto constant = constant_indices_.find(key);
+	if (constant == constant_indices_.end()) {
+		constants.push_back(ParseConstant(value, type, lexer_.GetPos(), lexer_.GetLine()));
+		constant = constant_indices_.emplace(key, constants.size() - 1).first;
+	}
+	operations.emplace_back(new execution::ValueOperation(constant->second));
 }
 
 void Parser::CheckLexeme(Lexeme::LexemeType type) {
@@ -73,8 +97,9 @@ int Parser::ProcessLoop(const execution::OperationIndex label_if, const executio
 	}
 
 	if (for_loop) {
-		operations.emplace_back(new execution::VariableOperation(value, lexer_.GetPos(), lexer_.GetLine()));
-		operations.emplace_back(new execution::AddOneOperation(value));
+		const VariableSlot slot = Resolve(value);
+		operations.emplace_back(new execution::VariableOperation(value, slot, lexer_.GetPos(), lexer_.GetLine()));
+		operations.emplace_back(new execution::AddOneOperation(slot));
 	}
 
 	operations.emplace_back(new execution::GoOperation(label_if));
@@ -214,14 +239,16 @@ int Parser::ForBlock() {
 }
 
 const execution::OperationIndex Parser::PrepForLoopParams(Lexeme lex) {
-	operations.emplace_back(new execution::AssignOperation(lex.value));
+	const VariableSlot slot = Resolve(lex.value);
+	operations.emplace_back(new execution::AssignOperation(slot));
 
 	const execution::OperationIndex label_if = operations.size();
 	loop_starts.emplace(label_if);
 
-	operations.emplace_back(new execution::VariableOperation(lex.value, lexer_.GetPos(), lexer_.GetLine()));
+	const std::string edge = "edge" + std::to_string(loop_starts.size() - 1);
+	operations.emplace_back(new execution::VariableOperation(lex.value, slot, lexer_.GetPos(), lexer_.GetLine()));
 	operations.emplace_back(new execution::VariableOperation(
-		"edge" + std::to_string(loop_starts.size() - 1), lexer_.GetPos(), lexer_.GetLine()));
+		edge, Resolve(edge), lexer_.GetPos(), lexer_.GetLine()));
 
 	return label_if;
 }
@@ -236,7 +263,7 @@ void Parser::Range() {
 	operations.emplace_back(new execution::GetRangeOperation(lexer_.GetPos(), lexer_.GetLine()));
 	
 	std::string edge = "edge" + std::to_string(loop_starts.size());	
-	operations.emplace_back(new execution::AssignOperation(edge));
+	operations.emplace_back(new execution::AssignOperation(Resolve(edge)));
 
 	CheckLexeme(Lexeme::RightParenthesis);
 	lexer_.TakeLexeme();
@@ -373,7 +400,7 @@ void Parser::Print() {
 		lexer_.TakeLexeme();
 		if (lexer_.HasLexeme() && lexer_.PeekLexeme().type == Lexeme::RightParenthesis) {
 			lexer_.TakeLexeme();
-			operations.emplace_back(new execution::ValueOperation("", Lexeme::StringConst, lexer_.GetPos(), lexer_.GetLine()));
+			PushConstant("", Lexeme::StringConst);
 
 				operations.emplace_back(new execution::PrintOperation());
 			return;
@@ -397,10 +424,6 @@ int Parser::GatherPrints() {
 	while (lexer_.HasLexeme() && lexer_.PeekLexeme().type == Lexeme::Comma) {
 		comma_cnt++;
 		lexer_.TakeLexeme();
-
-		operations.emplace_back(new execution::StrCast());
-
-		operations.emplace_back(new execution::ValueOperation(" ", Lexeme::StringConst, lexer_.GetPos(), lexer_.GetLine()));
 		Expression();
 	}
 	return comma_cnt;
@@ -408,15 +431,7 @@ int Parser::GatherPrints() {
 
 void Parser::PrintGathered(int comma_cnt) {
 	lexer_.TakeLexeme();
-	if (comma_cnt) {
-		operations.emplace_back(new execution::StrCast());
-	}
-
-	for (int i = 0; i < comma_cnt * 2; ++i) {
-		operations.emplace_back(new execution::ExecuteOperation(Lexeme::Add, lexer_.GetPos(), lexer_.GetLine()));
-	}
-
-	operations.emplace_back(new execution::PrintOperation());
+	operations.emplace_back(new execution::PrintOperation(comma_cnt + 1));
 }
 
 void Parser::Assign() {
@@ -425,7 +440,7 @@ void Parser::Assign() {
 		if (lexer_.PeekLexeme().type == Lexeme::Assign) {
 			lexer_.TakeLexeme();
 			Expression();
-			operations.emplace_back(new execution::AssignOperation(lex.value));
+			operations.emplace_back(new execution::AssignOperation(Resolve(lex.value)));
 			return;
 		} 
 		if (lexer_.PeekLexeme().type == Lexeme::EOL) {
@@ -444,9 +459,7 @@ void Parser::Expression() {
 			break;
 		}
 		lexer_.TakeLexeme();
-		OrParts();
-
-		operations.emplace_back(new execution::ExecuteOperation(Lexeme::Or, lexer_.GetPos(), lexer_.GetLine()));
+		ShortCircuit(Lexeme::Or, &Parser::OrParts);
 	}
 }
 
@@ -457,10 +470,30 @@ void Parser::OrParts() {
 			break;
 		}
 		lexer_.TakeLexeme();
-		AndParts();
+		ShortCircuit(Lexeme::And, &Parser::AndParts);
+	}
+}
 
-		operations.emplace_back(new execution::ExecuteOperation(Lexeme::And, lexer_.GetPos(), lexer_.GetLine()));
+// The left operand is on the stack. "and" compiles to
+//   if false_label; right; bool; go end; false_label: False; end:
+// and "or" negates the left operand first and pushes True instead,
+// so the right operand only runs when it decides the bool result
+void Parser::ShortCircuit(Lexeme::LexemeType op_type, void (Parser::*right)()) {
+	const bool is_or = op_type == Lexeme::Or;
+	if (is_or) {
+		operations.emplace_back(new execution::NotOperation);
 	}
+	const execution::OperationIndex if_index = operations.size();
+	operations.emplace_back(nullptr);
+
+	(this->*right)();
+	operations.emplace_back(new execution::BoolCast);
+	const execution::OperationIndex go_index = operations.size();
+	operations.emplace_back(nullptr);
+
+	operations[if_index].reset(new execution::IfOperation(operations.size()));
+	PushConstant(is_or ? "True" : "False", Lexeme::BoolConst);
+	operations[go_index].reset(new execution::GoOperation(operations.size()));
 }
 
 void Parser::AndParts() {
@@ -589,13 +622,14 @@ void Parser::Members() {
 
 	switch (lexeme.type) {
 		case Lexeme::Identifier:
-			operations.emplace_back(new execution::VariableOperation(lexeme.value, lexer_.GetPos(), lexer_.GetLine()));
+			operations.emplace_back(new execution::VariableOperation(
+				lexeme.value, Resolve(lexeme.value), lexer_.GetPos(), lexer_.GetLine()));
 			return;
 		case Lexeme::IntegerConst:
 		case Lexeme::BoolConst:
 		case Lexeme::FloatConst:
 		case Lexeme::StringConst:
-			operations.emplace_back(new ValueOperation(lexeme.value, lexeme.type, lexer_.GetPos(), lexer_.GetLine()));
+			PushConstant(lexeme.value, lexeme.type);
 			return;
 		default:
 			break;
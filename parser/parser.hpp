@@ -18,7 +18,15 @@ using namespace execution;
 class Parser{
  public:
 	explicit Parser(std::istream& input);
+	// Parses size bytes at data, which must outlive the parser
+	Parser(const char* data, std::size_t size);
 	Operations operations;
+	// Names of the variable slots, indexed by VariableSlot
+	std::vector<VariableName> variables;
+	// Constant pool of converted literals, indexed by ConstantIndex
+	std::vector<PolymorphicValue> constants;
+	// Static bound of the operand stack, the optimizer never makes it deeper
+	std::size_t max_stack_depth = 0;
 	void Run();
 
  private:
@@ -28,6 +36,11 @@ class Parser{
 	std::stack<const execution::OperationIndex> loop_starts;
 	std::stack<const execution::OperationIndex> breaks;
 	std::stack<const execution::OperationIndex> continues;
+	std::unordered_map<VariableName, VariableSlot> slots_;
+	std::map<std::pair<Lexeme::LexemeType, std::string>, ConstantIndex> constant_indices_;
+
+	VariableSlot Resolve(const VariableName& name);
+	void PushConstant(const std::string& value, Lexeme::LexemeType type);
 
 	void CheckLexeme(Lexeme::LexemeType type);
 
@@ -68,6 +81,7 @@ class Parser{
 	void Expression();
 	void OrParts();
 	void AndParts();
+	void ShortCircuit(Lexeme::LexemeType op_type, void (Parser::*right)());
 	void LogicalParts();
 	void CompParts();
 	void SumParts();
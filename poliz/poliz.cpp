@@ -11,6 +11,9 @@
 
 #include "../lexer/lexer.hpp"
 #include "poliz.hpp"
+#include "../output/output.hpp"
+#include "../format/format.hpp"
+#include "../bytecode/bytecode.hpp"
 
 namespace execution {
 
@@ -21,17 +24,79 @@ const std::string& ToStringSem(ValueType type) {
 	return kResults.at(type);
 }
 
-PolymorphicValue::PolymorphicValue(const char* str): type_(Str), str_(str) {}
-PolymorphicValue::PolymorphicValue(const std::string& str): type_(Str), str_(str) {}
+PolymorphicValue::PolymorphicValue(const char* str): type_(Str), str_(new StringData{str, 1}) {}
+PolymorphicValue::PolymorphicValue(const std::string& str): type_(Str), str_(new StringData{str, 1}) {}
 PolymorphicValue::PolymorphicValue(int integral): type_(Int), integral_(integral) {}
 PolymorphicValue::PolymorphicValue(double real): type_(Real), real_(real) {}
 PolymorphicValue::PolymorphicValue(bool logic): type_(Logic), logic_(logic) {}
 
-ValueType PolymorphicValue::GetType() {
+PolymorphicValue::PolymorphicValue(const PolymorphicValue& other) {
+	CopyFrom(other);
+	Retain();
+}
+
+PolymorphicValue::PolymorphicValue(PolymorphicValue&& other) noexcept {
+	CopyFrom(other);
+	other.type_ = Int;
+}
+
+PolymorphicValue& PolymorphicValue::operator=(const PolymorphicValue& other) {
+	other.Retain();
+	Release();
+	CopyFrom(other);
+	return *this;
+}
+
+PolymorphicValue& PolymorphicValue::operator=(PolymorphicValue&& other) noexcept {
+	if (this != &other) {
+		Release();
+		CopyFrom(other);
+		other.type_ = Int;
+	}
+	return *this;
+}
+
+PolymorphicValue::~PolymorphicValue() {
+	Release();
+}
+
+void PolymorphicValue::CopyFrom(const PolymorphicValue& other) {
+	type_ = other.type_;
+	switch (type_) {
+		case Str:
+			str_ = other.str_;
+			break;
+		case Int:
+			integral_ = other.integral_;
+			break;
+		case Real:
+			real_ = other.real_;
+			break;
+		case Logic:
+			logic_ = other.logic_;
+			break;
+	}
+}
+
+void PolymorphicValue::Retain() const {
+	if (type_ == Str) {
+		++str_->refs;
+	}
+}
+
+void PolymorphicValue::Release() {
+	if (type_ == Str && --str_->refs == 0) {
+		delete str_;
+	}
+}
+
+ValueType PolymorphicValue::GetType() const {
 	return type_;
 }
 
-PolymorphicValue::operator std::string() const { CheckIs(Str); return str_; }
+PolymorphicValue::operator std::string() const { CheckIs(Str); return str_->str; }
+const std::string& PolymorphicValue::GetString() const { CheckIs(Str); return str_->str; }
+void* PolymorphicValue::Payload() { return &integral_; }
 PolymorphicValue::operator double() const { CheckIs(Real); return real_; }
 
 PolymorphicValue::operator int() const {
@@ -57,7 +122,7 @@ PolymorphicValue::operator bool() const {
 		return integral_ == 0 ? false : true;
 	}
 	else if (type_ == Str) {
-		return str_ == "" ? false : true;
+		return str_->str.empty() ? false : true;
 	}
 	return real_ == 0 ? false : true;
 }
@@ -69,9 +134,6 @@ void PolymorphicValue::CheckIs(ValueType type) const {
 	}
 }
 
-Variable::Variable(const VariableName& name, const PolymorphicValue& value):
-	name(name), value(value) {}
-
 StackValue::StackValue(Variable* variable): variable_(variable), value_(0) {}
 
 StackValue::StackValue(PolymorphicValue value): variable_(nullptr), value_(value) {}
@@ -84,72 +146,96 @@ StackValue StackValue::SetValue(const StackValue& value) {
 	return variable_->value;
 }
 
-PolymorphicValue StackValue::Get() const {
+const PolymorphicValue& StackValue::Get() const {
 	return variable_ != nullptr ? variable_->value : value_;
 }
 
 Operation::~Operation() {}
 
-ValueOperation::ValueOperation(std::string value, Lexeme::LexemeType type, int pos, int line):
-			value_(value), type_(type), pos_(pos), line_(line) {}
-
-void ValueOperation::Do(Context& context) const {
-	switch (type_) {
-		case Lexeme::IntegerConst:
-			try {
-				context.stack.emplace(std::stoi(value_));
-			} catch (std::out_of_range) {
-				throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
-				": RangeError: " + value_ + " is too big for int");
+PolymorphicValue ParseConstant(const std::string& value, Lexeme::LexemeType type, int pos, int line) {
+	// The lexer only lets well-formed literals through, so range is all that can fail
+	switch (type) {
+		case Lexeme::IntegerConst: {
+			int integral = 0;
+			if (ParseInt(value, integral) == ParseStatus::OutOfRange) {
+				throw std::runtime_error("line " + std::to_string(line) + ":" + std::to_string(pos) + 
+				": RangeError: " + value + " is too big for int");
 			}
-			break;
+			return integral;
+		}
 		case Lexeme::BoolConst:
-			context.stack.emplace((value_ == "True" ? true : false));
-			break;
-		case Lexeme::FloatConst:
-			try {
-				context.stack.emplace(std::stod(value_));
-			} catch (std::out_of_range) {
-				throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
-				": RangeError: " + value_ + " is too precise for double");
+			return value == "True" ? true : false;
+		case Lexeme::FloatConst: {
+			double real = 0.0;
+			if (ParseReal(value, real) == ParseStatus::OutOfRange) {
+				throw std::runtime_error("line " + std::to_string(line) + ":" + std::to_string(pos) + 
+				": RangeError: " + value + " is too precise for double");
 			}
-			break;
-		case Lexeme::StringConst:
-			context.stack.emplace(value_);
-			break;
+			return real;
+		}
 		default:
-			break;
+			return value;
 	}
 }
 
-VariableOperation::VariableOperation(const VariableName& name, int pos, int line): 
-							name_(name), pos_(pos), line_(line) {}
+ValueOperation::ValueOperation(ConstantIndex index): index_(index) {}
+
+void ValueOperation::Do(Context& context) const {
+	context.stack.emplace(context.constants[index_]);
+}
+
+void ValueOperation::Encode(Program& program) const {
+	program.Emit(Opcode::PushConst, 0, index_);
+}
+
+VariableOperation::VariableOperation(const VariableName& name, VariableSlot slot, int pos, int line): 
+							name_(name), slot_(slot), pos_(pos), line_(line) {}
 
 void VariableOperation::Do(Context& context) const {
-	try {
-		context.stack.emplace(context.variables.at(name_).get());
-	} catch (std::out_of_range) {
+	Variable& variable = context.variables[slot_];
+	if (!variable.defined) {
 		throw std::runtime_error("line " + std::to_string(line_) + ":" +
 		std::to_string(pos_) + ": NameError: name '" + name_ +"' is not defined");
 	}
+	context.stack.emplace(&variable);
+}
+
+void VariableOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Load, 0, slot_, pos_, line_);
 }
 
-AssignOperation::AssignOperation(const VariableName& name): name_(name) {}
+VariableSlot VariableOperation::GetSlot() const {
+	return slot_;
+}
+
+AssignOperation::AssignOperation(VariableSlot slot): slot_(slot) {}
 
 void AssignOperation::Do(Context& context) const {
 	StackValue value = context.stack.top();
 	context.stack.pop();
 
-	context.variables[name_].reset(new Variable(name_, value.Get()));
+	Variable& variable = context.variables[slot_];
+	variable.value = value.Get();
+	variable.defined = true;
 }
 
-AddOneOperation::AddOneOperation(const VariableName& name): name_(name) {}
+void AssignOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Store, 0, slot_);
+}
+
+AddOneOperation::AddOneOperation(VariableSlot slot): slot_(slot) {}
 
 void AddOneOperation::Do(Context& context) const {
 	StackValue value = context.stack.top();
 	context.stack.pop();
 
-	context.variables[name_].reset(new Variable(name_, int(value.Get()) + 1));
+	Variable& variable = context.variables[slot_];
+	variable.value = int(value.Get()) + 1;
+	variable.defined = true;
+}
+
+void AddOneOperation::Encode(Program& program) const {
+	program.Emit(Opcode::AddOne, 0, slot_);
 }
 
 GoOperation::GoOperation(OperationIndex index): index_(index) {}
@@ -158,6 +244,10 @@ void GoOperation::Do(Context& context) const {
 	context.operation_index = index_;
 }
 
+void GoOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Go, 0, index_);
+}
+
 IfOperation::IfOperation(OperationIndex index): GoOperation(index) {}
 
 void IfOperation::Do(Context& context) const {
@@ -169,6 +259,10 @@ void IfOperation::Do(Context& context) const {
 	}
 }
 
+void IfOperation::Encode(Program& program) const {
+	program.Emit(Opcode::If, 0, index_);
+}
+
 UnaryMinusOperation::UnaryMinusOperation(int pos, int line): pos_(pos), line_(line) {}
 
 void UnaryMinusOperation::Do(Context& context) const {
@@ -190,12 +284,20 @@ void UnaryMinusOperation::Do(Context& context) const {
 	
 }
 
+void UnaryMinusOperation::Encode(Program& program) const {
+	program.Emit(Opcode::UnaryMinus, 0, 0, pos_, line_);
+}
+
 void NotOperation::Do(Context& context) const {
 	const PolymorphicValue new_value(!(bool(context.stack.top().Get())));
 	context.stack.pop();
 	context.stack.push(new_value);
 }
 
+void NotOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Not);
+}
+
 GetRangeOperation::GetRangeOperation(int pos, int line): pos_(pos), line_(line) {}
 
 void GetRangeOperation::Do(Context& context) const {
@@ -221,98 +323,114 @@ void GetRangeOperation::Do(Context& context) const {
 	}
 }
 
-void MathOperation::Do(Context& context) const {}
+void GetRangeOperation::Encode(Program& program) const {
+	program.Emit(Opcode::GetRange, 0, 0, pos_, line_);
+}
+
+// A site whose operand types keep changing stays generic after this many deoptimizations
+const std::size_t kMaxDeoptimizations = 4;
 
 ExecuteOperation::ExecuteOperation(Lexeme::LexemeType type, int pos, int line):
 					type_(type), pos_(pos), line_(line) {}
 
+// Reads an operand as T; strings are borrowed rather than copied
+template<typename T>
+decltype(auto) Read(const StackValue& op) {
+	if constexpr (std::is_same_v<T, std::string>) {
+		return op.Get().GetString();
+	}
+	else {
+		return static_cast<T>(op.Get());
+	}
+}
+
 template<typename T1, typename T2>
-StackValue PlusOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) + static_cast<T2>(op2.Get()));
+StackValue PlusOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) + Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue MinusOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) - static_cast<T2>(op2.Get()));
+StackValue MinusOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) - Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue MulOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) * static_cast<T2>(op2.Get()));
+StackValue MulOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) * Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue MulStrLOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
+StackValue MulStrLOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
 	std::string new_str = "";
-	std::string old_str = static_cast<T2>(op2.Get());
+	const std::string& old_str = Read<T2>(op2);
 
-	for (int i = 0; i < static_cast<T1>(op1.Get()); ++i) {
+	for (int i = 0; i < Read<T1>(op1); ++i) {
 		new_str += old_str;
 	}
 	return StackValue(new_str);
 }
 
 template<typename T1, typename T2>
-StackValue MulStrROperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
+StackValue MulStrROperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
 	std::string new_str = "";
-	std::string old_str = static_cast<T1>(op1.Get());
+	const std::string& old_str = Read<T1>(op1);
 
-	for (int i = 0; i < static_cast<T2>(op2.Get()); ++i) {
+	for (int i = 0; i < Read<T2>(op2); ++i) {
 		new_str += old_str;
 	}
 	return StackValue(new_str);
 }
 
 template<typename T1, typename T2>
-StackValue DivOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) / static_cast<T2>(op2.Get()));
+StackValue DivOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) / Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue ModOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) % static_cast<T2>(op2.Get()));
+StackValue ModOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) % Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue LessOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) < static_cast<T2>(op2.Get()));
+StackValue LessOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) < Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue LessEqOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) <= static_cast<T2>(op2.Get()));
+StackValue LessEqOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) <= Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue GreaterOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) > static_cast<T2>(op2.Get()));
+StackValue GreaterOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) > Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue GreaterEqOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) >= static_cast<T2>(op2.Get()));
+StackValue GreaterEqOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) >= Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue EqualOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) == static_cast<T2>(op2.Get()));
+StackValue EqualOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) == Read<T2>(op2));
 }
 
 template<typename T1, typename T2>
-StackValue EqualStrOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
+StackValue EqualStrOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
 	return StackValue(false);
 }
 
 template<typename T1, typename T2>
-StackValue NotEqualOperation<T1, T2>::DoMath(StackValue op1, StackValue op2) const {
-	return StackValue(static_cast<T1>(op1.Get()) != static_cast<T2>(op2.Get()));
+StackValue NotEqualOperation<T1, T2>::DoMath(const StackValue& op1, const StackValue& op2) {
+	return StackValue(Read<T1>(op1) != Read<T2>(op2));
 }
 
-StackValue AndOperation::DoMath(StackValue op1, StackValue op2) const {
+StackValue AndOperation::DoMath(const StackValue& op1, const StackValue& op2) {
 	return StackValue(bool((op1.Get())) && bool((op2.Get())));
 }
 
-StackValue OrOperation::DoMath(StackValue op1, StackValue op2) const {
+StackValue OrOperation::DoMath(const StackValue& op1, const StackValue& op2) {
 	return StackValue(bool((op1.Get())) || bool((op2.Get())));
 }
 
@@ -322,24 +440,36 @@ void BoolCast::Do(Context& context) const {
 	context.stack.emplace(bool(op.Get()));
 }
 
+void BoolCast::Encode(Program& program) const {
+	program.Emit(Opcode::Cast, Lexeme::Bool);
+}
+
 IntCast::IntCast(int pos, int line): pos_(pos), line_(line) {}
 
 void IntCast::Do(Context& context) const {
 	StackValue op = context.stack.top();
 	context.stack.pop();
 	switch (op.Get().GetType()) {
-		case Str:
-			if (std::string(op.Get()) == "True" || std::string(op.Get()) == "False") {
-				std::string(op.Get()) == "False" ? context.stack.emplace(0) : context.stack.emplace(1);
+		case Str: {
+			const std::string& str = op.Get().GetString();
+			if (str == "True" || str == "False") {
+				str == "False" ? context.stack.emplace(0) : context.stack.emplace(1);
 				break;
 			}
-			try {
-				context.stack.emplace(std::stoi(std::string(op.Get())));
-			} catch (std::out_of_range) {
-				throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
-				": RangeError: " + std::string(op.Get()) + " is too big for int()");
+			int integral = 0;
+			switch (ParseInt(str, integral)) {
+				case ParseStatus::Ok:
+					context.stack.emplace(integral);
+					break;
+				case ParseStatus::OutOfRange:
+					throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
+					": RangeError: " + str + " is too big for int()");
+				case ParseStatus::Invalid:
+					throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
+					": ValueError: invalid literal for int(): '" + str + "'");
 			}
 			break;
+		}
 		case Logic:
 		case Int:
 			context.stack.emplace(int(op.Get()));
@@ -351,6 +481,10 @@ void IntCast::Do(Context& context) const {
 			break;
 	}
 }
+
+void IntCast::Encode(Program& program) const {
+	program.Emit(Opcode::Cast, Lexeme::Int, 0, pos_, line_);
+}
 FloatCast::FloatCast(int pos, int line): pos_(pos), line_(line) {}
 
 void FloatCast::Do(Context& context) const {
@@ -360,18 +494,26 @@ void FloatCast::Do(Context& context) const {
 		case Logic:
 			context.stack.emplace(double(bool(op.Get())));
 			break;
-		case Str:
-			if (std::string(op.Get()) == "True" || std::string(op.Get()) == "False") {
-				std::string(op.Get()) == "False" ? context.stack.emplace(0.0) : context.stack.emplace(1.0);
+		case Str: {
+			const std::string& str = op.Get().GetString();
+			if (str == "True" || str == "False") {
+				str == "False" ? context.stack.emplace(0.0) : context.stack.emplace(1.0);
 				break;
 			}
-			try {
-				context.stack.emplace(std::stod(std::string(op.Get())));
-			} catch (std::out_of_range) {
-				throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
-				": RangeError: " + std::string(op.Get()) + " is too precise for float()");
+			double real = 0.0;
+			switch (ParseReal(str, real)) {
+				case ParseStatus::Ok:
+					context.stack.emplace(real);
+					break;
+				case ParseStatus::OutOfRange:
+					throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
+					": RangeError: " + str + " is too precise for float()");
+				case ParseStatus::Invalid:
+					throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
+					": ValueError: could not convert string to float: '" + str + "'");
 			}
 			break;
+		}
 		case Int:
 			context.stack.emplace(double(int(op.Get())));
 			break;
@@ -383,6 +525,10 @@ void FloatCast::Do(Context& context) const {
 	}
 }
 
+void FloatCast::Encode(Program& program) const {
+	program.Emit(Opcode::Cast, Lexeme::Float, 0, pos_, line_);
+}
+
 void StrCast::Do(Context& context) const {
 	StackValue op = context.stack.top();
 	context.stack.pop();
@@ -392,18 +538,23 @@ void StrCast::Do(Context& context) const {
 		bool(op.Get()) == false ? context.stack.emplace("False") : context.stack.emplace("True");
 		break;
 	case Str:
-		context.stack.emplace(std::string(op.Get()));
+		// Shares the buffer of the operand
+		context.stack.emplace(op.Get());
 		break;
 	case Int:
-		context.stack.emplace(std::to_string(int(op.Get())));
+		context.stack.emplace(IntToString(int(op.Get())));
 		break;
 	case Real:
-		context.stack.emplace(std::to_string(double(op.Get())));
+		context.stack.emplace(RealToString(double(op.Get())));
 		break;
 	default:
 		break;
 	}
 }
+
+void StrCast::Encode(Program& program) const {
+	program.Emit(Opcode::Cast, Lexeme::Str);
+}
 Cast::Cast(Lexeme::LexemeType cast_type, int pos, int line): cast_type_(cast_type), pos_(pos), line_(line) {}
 
 void Cast::Do(Context& context) const {
@@ -425,44 +576,319 @@ void Cast::Do(Context& context) const {
 	}
 }
 
-void PrintOperation::Do(Context& context) const {
-	StackValue op = context.stack.top();
-	context.stack.pop();
-	switch (op.Get().GetType()) {
+void Cast::Encode(Program& program) const {
+	program.Emit(Opcode::Cast, cast_type_, 0, pos_, line_);
+}
+
+namespace {
+
+// Writes the value the way str() converts it
+void WriteValue(Output& out, const PolymorphicValue& value) {
+	char buffer[kMaxNumberChars];
+	switch (value.GetType()) {
 		case Logic:
-			std::cout << (bool(op.Get()) == 1 ? "True" : "False") << std::endl;
+			out.Write(bool(value) ? "True" : "False");
 			break;
 		case Str:
-			std::cout << std::string(op.Get()) << std::endl;
+			out.Write(value.GetString());
 			break;
 		case Int:
-			std::cout << int(op.Get()) << std::endl;
+			out.Write(buffer, FormatInt(buffer, int(value)) - buffer);
 			break;
 		case Real:
-			std::cout << double(op.Get()) << std::endl;
-			break;
-		default:
+			out.Write(buffer, FormatReal(buffer, double(value)) - buffer);
 			break;
 	}
 }
 
+// RangeContinues for a counter and bound known to hold ints
+bool IntsLess(const Context& context, VariableSlot counter, VariableSlot bound) {
+	return int(context.variables[counter].value) < int(context.variables[bound].value);
+}
+
+} // namespace
+
+PrintOperation::PrintOperation(std::size_t count): count_(count) {}
+
+void PrintOperation::Do(Context& context) const {
+	Output& out = Stdout();
+	for (std::size_t below = count_; below-- > 0;) {
+		WriteValue(out, context.stack.top(below).Get());
+		if (below > 0) {
+			out.Write(' ');
+		}
+	}
+	out.EndLine();
+	for (std::size_t i = 0; i < count_; ++i) {
+		context.stack.pop();
+	}
+}
+
+void PrintOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Print, 0, count_);
+}
+
 #include "poliz.tpp"
 
+StackValue DoBinary(OperationType type, const StackValue& op1, const StackValue& op2, int pos, int line) {
+	const ValueType type1 = op1.Get().GetType();
+	const ValueType type2 = op2.Get().GetType();
+	const MathFunction math = kMathBinaries[MathIndex(type, type1, type2)];
+	if (!math) {
+		throw std::runtime_error("line " + std::to_string(line) + ":" + std::to_string(pos) + 
+				": TypeError: unsupported operand type(s) for " + Lexeme::TypeToString(type) + ": " +  
+				ToStringSem(type1) + " and " + ToStringSem(type2));
+	}
+	return math(op1, op2);
+}
+
+MathFunction FindMath(OperationType type, ValueType type1, ValueType type2) {
+	return kMathBinaries[MathIndex(type, type1, type2)];
+}
+
+TypedExecuteOperation::TypedExecuteOperation(OperationType type, ValueType type1, ValueType type2, int pos, int line):
+					type_(type), type1_(type1), type2_(type2), math_(FindMath(type, type1, type2)), pos_(pos), line_(line) {}
+
+void TypedExecuteOperation::Do(Context& context) const {
+	StackValue op2 = context.stack.top();
+	context.stack.pop();
+
+	StackValue op1 = context.stack.top();
+	context.stack.pop();
+
+	context.stack.emplace(math_(op1, op2));
+}
+
+void TypedExecuteOperation::Encode(Program& program) const {
+	program.Emit({Opcode::TypedBinary, std::uint8_t(type_), std::uint32_t(type1_), std::uint32_t(type2_),
+		program.AddMath(math_)}, pos_, line_);
+}
+
+std::string TypedExecuteOperation::Name() const {
+	return TypedName(type_, type1_, type2_);
+}
+
+std::string TypedName(OperationType type, ValueType type1, ValueType type2) {
+	static const std::unordered_map<int, std::string> kNames {
+		{Lexeme::Add, "Add"}, {Lexeme::Sub, "Sub"}, {Lexeme::Mul, "Mul"}, {Lexeme::Div, "Div"},
+		{Lexeme::Mod, "Mod"}, {Lexeme::Less, "Less"}, {Lexeme::LessEq, "LessEq"}, {Lexeme::Greater, "Greater"},
+		{Lexeme::GreaterEq, "GreaterEq"}, {Lexeme::Equal, "Equal"}, {Lexeme::NotEqual, "NotEqual"},
+		{Lexeme::And, "And"}, {Lexeme::Or, "Or"},
+	};
+	static const std::string kTypes[] = {"Str", "Int", "Real", "Bool"};
+	std::string name = kNames.at(type);
+	if (type1 == Str && type2 == Str && type == Lexeme::Add) {
+		name = "Concat";
+	}
+	else if ((type1 == Str) != (type2 == Str) && type == Lexeme::Mul) {
+		name = "Repeat";
+	}
+	return name + kTypes[type1] + kTypes[type2];
+}
+
+bool RangeContinues(Context& context, VariableSlot counter, VariableSlot bound, int pos, int line) {
+	Variable& counter_variable = context.variables[counter];
+	Variable& bound_variable = context.variables[bound];
+	if (counter_variable.value.GetType() == Int && bound_variable.value.GetType() == Int) {
+		return int(counter_variable.value) < int(bound_variable.value);
+	}
+	return bool(DoBinary(Lexeme::Less, &counter_variable, &bound_variable, pos, line).Get());
+}
+
 void ExecuteOperation::Do(Context& context) const {
 	StackValue op2 = context.stack.top();
 	context.stack.pop();
 
 	StackValue op1 = context.stack.top();
 	context.stack.pop();
-	try {
-		context.stack.emplace(
-			execution::kMathBinaries.at(
-				std::make_tuple(type_, op1.Get().GetType(), op2.Get().GetType()))->DoMath(op1, op2));
-	} catch (std::out_of_range) {
-		throw std::runtime_error("line " + std::to_string(line_) + ":" + std::to_string(pos_) + 
-				": TypeError: unsupported operand type(s) for " + Lexeme::TypeToString(type_) + ": " +  
-				ToStringSem(op1.Get().GetType()) + " and " + ToStringSem(op2.Get().GetType()));
+
+	context.stack.emplace(Apply(op1, op2, context.count_caches));
+	if (!context.operations || cache_.deoptimizations >= kMaxDeoptimizations) {
+		return;
+	}
+	// Apply returned, so the cache holds the function for these operand types
+	std::shared_ptr<Operation>& slot = (*context.operations)[context.operation_index - 1];
+	if (slot.get() == this) {
+		slot = std::make_shared<QuickenedExecuteOperation>(
+			std::static_pointer_cast<ExecuteOperation>(slot), context.count_caches);
 	}
 }
 
+void ExecuteOperation::Encode(Program& program) const {
+	program.Emit(Opcode::Binary, type_, 0, pos_, line_);
+}
+
+StackValue ExecuteOperation::Apply(const StackValue& op1, const StackValue& op2, bool count) const {
+	const ValueType type1 = op1.Get().GetType();
+	const ValueType type2 = op2.Get().GetType();
+	if (type1 == cache_.type1 && type2 == cache_.type2 && cache_.math) {
+		if (count) {
+			++cache_.hits;
+		}
+		return cache_.math(op1, op2);
+	}
+	if (count) {
+		++cache_.misses;
+	}
+	const MathFunction math = FindMath(type_, type1, type2);
+	if (!math) {
+		// Reports the TypeError
+		return DoBinary(type_, op1, op2, pos_, line_);
+	}
+	cache_.type1 = type1;
+	cache_.type2 = type2;
+	cache_.math = math;
+	return math(op1, op2);
+}
+
+const ExecuteOperation* ExecuteOperation::Site() const {
+	return this;
+}
+
+const InlineCache& ExecuteOperation::Cache() const {
+	return cache_;
+}
+
+void ExecuteOperation::CountHit() const {
+	++cache_.hits;
+}
+
+void ExecuteOperation::CountDeoptimization() const {
+	++cache_.deoptimizations;
+}
+
+std::string ExecuteOperation::Describe() const {
+	return "line " + std::to_string(line_) + ":" + std::to_string(pos_) + ": " + Lexeme::TypeToString(type_);
+}
+
+QuickenedExecuteOperation::QuickenedExecuteOperation(std::shared_ptr<ExecuteOperation> site, bool count):
+	site_(site), type1_(site->Cache().type1), type2_(site->Cache().type2), math_(site->Cache().math), count_(count) {}
+
+void QuickenedExecuteOperation::Do(Context& context) const {
+	const StackValue& op2 = context.stack.top();
+	const StackValue& op1 = context.stack.top(1);
+	if (op1.Get().GetType() != type1_ || op2.Get().GetType() != type2_) {
+		// Giving the slot back may destroy this operation, so only the copy of site is used after it
+		const std::shared_ptr<ExecuteOperation> site = site_;
+		site->CountDeoptimization();
+		if (context.operations) {
+			(*context.operations)[context.operation_index - 1] = site;
+		}
+		site->Do(context);
+		return;
+	}
+	if (count_) {
+		site_->CountHit();
+	}
+	StackValue result = math_(op1, op2);
+	context.stack.pop();
+	context.stack.pop();
+	context.stack.emplace(std::move(result));
+}
+
+void QuickenedExecuteOperation::Encode(Program& program) const {
+	site_->Encode(program);
+}
+
+const ExecuteOperation* QuickenedExecuteOperation::Site() const {
+	return site_.get();
+}
+
+ExecuteVariablesOperation::ExecuteVariablesOperation(const VariableOperation& first, const VariableOperation& second,
+							const ExecuteOperation& execute): first_(first), second_(second), execute_(execute), math_(nullptr) {}
+
+ExecuteVariablesOperation::ExecuteVariablesOperation(const ExecuteVariablesOperation& fused, MathFunction math):
+	first_(fused.first_), second_(fused.second_), execute_(fused.execute_), math_(math) {}
+
+void ExecuteVariablesOperation::Do(Context& context) const {
+	Variable& op1 = context.variables[first_.GetSlot()];
+	Variable& op2 = context.variables[second_.GetSlot()];
+	if (!op1.defined || !op2.defined) {
+		// Let the plain operations report the NameError
+		first_.Do(context);
+		second_.Do(context);
+		execute_.Do(context);
+		return;
+	}
+	context.stack.emplace(math_ ? math_(&op1, &op2) : execute_.Apply(&op1, &op2, context.count_caches));
+}
+
+const ExecuteOperation* ExecuteVariablesOperation::Site() const {
+	return &execute_;
+}
+
+void ExecuteVariablesOperation::Encode(Program& program) const {
+	execute_.Encode(program);
+	Instruction& instruction = program.code.back();
+	instruction.opcode = Opcode::ExecuteVariables;
+	instruction.operand = first_.GetSlot();
+	instruction.operand2 = second_.GetSlot();
+	instruction.operand3 = program.AddSlowPath(this);
+}
+
+ExecuteIfOperation::ExecuteIfOperation(const ExecuteOperation& execute, OperationIndex index):
+	GoOperation(index), execute_(execute), math_(nullptr) {}
+
+ExecuteIfOperation::ExecuteIfOperation(const ExecuteIfOperation& fused, MathFunction math):
+	GoOperation(fused.index_), execute_(fused.execute_), math_(math) {}
+
+void ExecuteIfOperation::Do(Context& context) const {
+	StackValue op2 = context.stack.top();
+	context.stack.pop();
+
+	StackValue op1 = context.stack.top();
+	context.stack.pop();
+
+	if (!bool((math_ ? math_(op1, op2) : execute_.Apply(op1, op2, context.count_caches)).Get())) {
+		GoOperation::Do(context);
+	}
+}
+
+const ExecuteOperation* ExecuteIfOperation::Site() const {
+	return &execute_;
+}
+
+void ExecuteIfOperation::Encode(Program& program) const {
+	execute_.Encode(program);
+	Instruction& instruction = program.code.back();
+	instruction.opcode = Opcode::ExecuteIf;
+	instruction.operand = index_;
+}
+
+ForRangeTestOperation::ForRangeTestOperation(OperationIndex exit, VariableSlot counter, VariableSlot bound, int pos, int line):
+	GoOperation(exit), counter_(counter), bound_(bound), pos_(pos), line_(line), ints_(false) {}
+
+ForRangeTestOperation::ForRangeTestOperation(const ForRangeTestOperation& fused, bool ints):
+	GoOperation(fused.index_), counter_(fused.counter_), bound_(fused.bound_), pos_(fused.pos_), line_(fused.line_),
+	ints_(ints) {}
+
+void ForRangeTestOperation::Do(Context& context) const {
+	if (!(ints_ ? IntsLess(context, counter_, bound_) : RangeContinues(context, counter_, bound_, pos_, line_))) {
+		GoOperation::Do(context);
+	}
+}
+
+void ForRangeTestOperation::Encode(Program& program) const {
+	program.Emit({Opcode::ForRangeTest, 0, std::uint32_t(index_), std::uint32_t(counter_), std::uint32_t(bound_)}, pos_, line_);
+}
+
+ForRangeNextOperation::ForRangeNextOperation(OperationIndex body, VariableSlot counter, VariableSlot bound, int pos, int line):
+	GoOperation(body), counter_(counter), bound_(bound), pos_(pos), line_(line), ints_(false) {}
+
+ForRangeNextOperation::ForRangeNextOperation(const ForRangeNextOperation& fused, bool ints):
+	GoOperation(fused.index_), counter_(fused.counter_), bound_(fused.bound_), pos_(fused.pos_), line_(fused.line_),
+	ints_(ints) {}
+
+void ForRangeNextOperation::Do(Context& context) const {
+	Variable& variable = context.variables[counter_];
+	variable.value = int(variable.value) + 1;
+	if (ints_ ? IntsLess(context, counter_, bound_) : RangeContinues(context, counter_, bound_, pos_, line_)) {
+		GoOperation::Do(context);
+	}
+}
+
+void ForRangeNextOperation::Encode(Program& program) const {
+	program.Emit({Opcode::ForRangeNext, 0, std::uint32_t(index_), std::uint32_t(counter_), std::uint32_t(bound_)}, pos_, line_);
+}
+
 }
\ No newline at end of file
@@ -9,6 +9,13 @@
 #include <vector>
 #include <stack>
 #include <map>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include "../lexer/lexer.hpp"
 
@@ -26,30 +33,50 @@ class PolymorphicValue {
 	PolymorphicValue(double real);
 	PolymorphicValue(bool logic);
 
+	PolymorphicValue(const PolymorphicValue& other);
+	PolymorphicValue(PolymorphicValue&& other) noexcept;
+	PolymorphicValue& operator=(const PolymorphicValue& other);
+	PolymorphicValue& operator=(PolymorphicValue&& other) noexcept;
+	~PolymorphicValue();
+
 	operator std::string() const;
 	operator int() const;
 	operator double() const;
 	operator bool() const;
 
-	ValueType GetType();
+	ValueType GetType() const;
+	// Borrows the string without copying it; the value must be a Str
+	const std::string& GetString() const;
+	// The int, double or bool in place, for native code that updates values of a fixed type
+	void* Payload();
 
   private:
+	// Strings are immutable, so copies share one buffer until the last owner drops it
+	struct StringData {
+		std::string str;
+		std::size_t refs;
+	};
+
 	ValueType type_;
-	std::string str_;
-	int integral_ = 0;
-	double real_ = 0.0;
-	bool logic_ = false;
+	union {
+		int integral_;
+		double real_;
+		bool logic_;
+		StringData* str_;
+	};
 
 	void CheckIs(ValueType type) const;
+	void CopyFrom(const PolymorphicValue& other);
+	void Retain() const;
+	void Release();
 };
 
 using VariableName = std::string;
+using VariableSlot = std::size_t;
 
 struct Variable {
-	VariableName name;
-	PolymorphicValue value;
-
-	Variable(const VariableName& name, const PolymorphicValue& value);
+	PolymorphicValue value = 0;
+	bool defined = false;
 };
 
 class StackValue {
@@ -57,7 +84,8 @@ class StackValue {
 	StackValue(Variable* variable);
 	StackValue(PolymorphicValue value);
 
-	PolymorphicValue Get() const;
+	// Borrowed: copy the value only when storing it beyond the stack value's lifetime
+	const PolymorphicValue& Get() const;
 
 	StackValue SetValue(const StackValue& value);
 
@@ -68,64 +96,154 @@ class StackValue {
 
 
 using OperationIndex = std::size_t;
+using ConstantIndex = std::size_t;
+
+// Converts a literal once at parse time, reporting RangeError for values that do not fit
+PolymorphicValue ParseConstant(const std::string& value, Lexeme::LexemeType type, int pos, int line);
+
+// Operand stack in a single block sized once from the static depth bound of the
+// program. Mirrors the std::stack interface; bounds are only checked by assert.
+class OperandStack {
+  public:
+	OperandStack() = default;
+	OperandStack(const OperandStack&) = delete;
+	OperandStack& operator=(const OperandStack&) = delete;
+	~OperandStack() { Clear(); }
+
+	// Drops the contents and makes room for capacity values
+	void Reserve(std::size_t capacity) {
+		Clear();
+		data_.reset(new Slot[capacity]);
+		capacity_ = capacity;
+	}
+
+	void push(const StackValue& value) { emplace(value); }
+
+	template<typename... Args>
+	void emplace(Args&&... args) {
+		assert(size_ < capacity_);
+		new (&data_[size_]) StackValue(std::forward<Args>(args)...);
+		++size_;
+	}
+
+	StackValue& top() {
+		return top(0);
+	}
+
+	// The value below entries under the top
+	StackValue& top(std::size_t below) {
+		assert(below < size_);
+		return *std::launder(reinterpret_cast<StackValue*>(&data_[size_ - 1 - below]));
+	}
+
+	void pop() {
+		assert(size_ > 0);
+		top().~StackValue();
+		--size_;
+	}
+
+	std::size_t size() const { return size_; }
+	bool empty() const { return size_ == 0; }
+
+  private:
+	using Slot = std::aligned_storage_t<sizeof(StackValue), alignof(StackValue)>;
+
+	std::unique_ptr<Slot[]> data_;
+	std::size_t capacity_ = 0;
+	std::size_t size_ = 0;
+
+	void Clear() {
+		while (size_ > 0) {
+			pop();
+		}
+	}
+};
+
+struct Operation;
+
+using Operations = std::vector<std::shared_ptr<Operation>>;
 
 struct Context {
 	OperationIndex operation_index = 0;
-	std::stack<StackValue> stack;
-	std::unordered_map<VariableName, std::unique_ptr<Variable> > variables;
+	// The operation being run, stored before its dispatch advances operation_index
+	// or jumps; read by the sampling profiler's signal handler
+	std::atomic<OperationIndex> current_index{0};
+	OperandStack stack;
+	// Indexed by the slots the parser gives to identifiers
+	std::vector<Variable> variables;
+	// Literals converted by the parser, indexed by ConstantIndex
+	std::vector<PolymorphicValue> constants;
+	// The operations being run, for sites that rewrite their own slot; null when
+	// they run from a compiled Program
+	Operations* operations = nullptr;
+	// Binary operation sites count inline cache hits and misses, for --stats
+	bool count_caches = false;
 };
 
+struct Program;
+
+struct ExecuteOperation;
+
 struct Operation {
 	virtual ~Operation();
 	virtual void Do(Context& context) const = 0;
+	// Appends the flat bytecode form of the operation, one instruction per operation
+	virtual void Encode(Program& program) const = 0;
+	// The binary operation site inside, if any, for reporting its inline cache
+	virtual const ExecuteOperation* Site() const { return nullptr; }
 };
 
 struct ValueOperation : Operation {
-	ValueOperation(std::string value, Lexeme::LexemeType type, int pos, int line);
+	ValueOperation(ConstantIndex index);
 
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 
   private:
-	std::string value_;
-	Lexeme::LexemeType type_;
-	int pos_;
-	int line_;
+	const ConstantIndex index_;
 };
 
 struct VariableOperation : Operation {
-	VariableOperation(const VariableName& name, int pos, int line);
+	VariableOperation(const VariableName& name, VariableSlot slot, int pos, int line);
 
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+
+	VariableSlot GetSlot() const;
 
 	private:
 	const VariableName name_;
+	const VariableSlot slot_;
 	int pos_;
 	int line_;
 };
 
 struct AssignOperation : Operation {
-	AssignOperation(const VariableName& name);
+	AssignOperation(VariableSlot slot);
 
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 
   private:
-	const VariableName name_;
+	const VariableSlot slot_;
 };
 
 struct AddOneOperation : Operation {
-	AddOneOperation(const VariableName& name);
+	AddOneOperation(VariableSlot slot);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 
   private:
-	const VariableName name_;
+	const VariableSlot slot_;
 };
 
 struct GoOperation : Operation {
 	GoOperation(OperationIndex index);
 
 	void Do(Context& context) const override;
+	void Encode(Program& program) const override;
 
-	private:
+	protected:
 	const OperationIndex index_;
 };
 
@@ -133,11 +251,13 @@ struct IfOperation : GoOperation {
 	IfOperation(OperationIndex index);
 
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 };
 
 struct UnaryMinusOperation : Operation {
 	UnaryMinusOperation(int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
   private:
 	int pos_;
 	int line_;
@@ -145,116 +265,220 @@ struct UnaryMinusOperation : Operation {
 
 struct NotOperation : Operation {
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 };
 
 struct GetRangeOperation : Operation {
 	GetRangeOperation(int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
  private:
 	int pos_;
 	int line_;
 };
 
-struct MathOperation : Operation {
-	void Do(Context& context) const final;
-	virtual StackValue DoMath(StackValue op1, StackValue op2) const = 0;
-	StackValue NDo(Context& context, Lexeme::LexemeType type) const;
+using MathFunction = StackValue (*)(const StackValue& op1, const StackValue& op2);
+
+// Operand types a binary operation site saw last and the kMathBinaries entry
+// for them, tried before the generic lookup
+struct InlineCache {
+	ValueType type1 = Str;
+	ValueType type2 = Str;
+	MathFunction math = nullptr;
+	std::size_t hits = 0;
+	std::size_t misses = 0;
+	// Times the quickened form of the site gave its slot back
+	std::size_t deoptimizations = 0;
 };
 
 struct ExecuteOperation : Operation {
 	ExecuteOperation(Lexeme::LexemeType type, int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+	const ExecuteOperation* Site() const final;
+
+	// Counts the hit or miss when count is set
+	StackValue Apply(const StackValue& op1, const StackValue& op2, bool count) const;
+
+	const InlineCache& Cache() const;
+	// Bookkeeping of QuickenedExecuteOperation, which runs in place of the site
+	void CountHit() const;
+	void CountDeoptimization() const;
+	// "line L:P: +" for reports
+	std::string Describe() const;
   private:
 	Lexeme::LexemeType type_;
 	int pos_;
 	int line_;
+	// Updated by Apply, which the engines call through a const operation
+	mutable InlineCache cache_;
+};
+
+// An ExecuteOperation rewritten in its operations slot once its operand types
+// had a kMathBinaries entry. Runs that entry while the operands keep those types
+// and gives the slot back to the generic site when they do not
+struct QuickenedExecuteOperation : Operation {
+	QuickenedExecuteOperation(std::shared_ptr<ExecuteOperation> site, bool count);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+	const ExecuteOperation* Site() const final;
+  private:
+	const std::shared_ptr<ExecuteOperation> site_;
+	const ValueType type1_;
+	const ValueType type2_;
+	const MathFunction math_;
+	const bool count_;
+};
+
+// Fused superinstructions, built by Fuse() from the plain operations above
+
+// load; load; binop with both operands read straight from their slots
+struct ExecuteVariablesOperation : Operation {
+	ExecuteVariablesOperation(const VariableOperation& first, const VariableOperation& second,
+							const ExecuteOperation& execute);
+	// The same site with its operand types proven by Specialize() to take math
+	ExecuteVariablesOperation(const ExecuteVariablesOperation& fused, MathFunction math);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+	const ExecuteOperation* Site() const final;
+  private:
+	const VariableOperation first_;
+	const VariableOperation second_;
+	const ExecuteOperation execute_;
+	// nullptr unless proven, then run without the inline cache
+	const MathFunction math_;
+};
+
+// binop; if
+struct ExecuteIfOperation : GoOperation {
+	ExecuteIfOperation(const ExecuteOperation& execute, OperationIndex index);
+	ExecuteIfOperation(const ExecuteIfOperation& fused, MathFunction math);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+	const ExecuteOperation* Site() const final;
+  private:
+	const ExecuteOperation execute_;
+	const MathFunction math_;
+};
+
+// Head of for ... in range: leaves the loop unless counter < bound
+struct ForRangeTestOperation : GoOperation {
+	ForRangeTestOperation(OperationIndex exit, VariableSlot counter, VariableSlot bound, int pos, int line);
+	// The same loop with counter and bound proven by Specialize() to be ints
+	ForRangeTestOperation(const ForRangeTestOperation& fused, bool ints);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+  private:
+	const VariableSlot counter_;
+	const VariableSlot bound_;
+	int pos_;
+	int line_;
+	// Compares the values as ints without looking at their types
+	const bool ints_;
+};
+
+// Tail of for ... in range: increments the counter and goes back to the body while counter < bound
+struct ForRangeNextOperation : GoOperation {
+	ForRangeNextOperation(OperationIndex body, VariableSlot counter, VariableSlot bound, int pos, int line);
+	ForRangeNextOperation(const ForRangeNextOperation& fused, bool ints);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+  private:
+	const VariableSlot counter_;
+	const VariableSlot bound_;
+	int pos_;
+	int line_;
+	// Compares the values as ints without looking at their types
+	const bool ints_;
 };
 
 template<typename T1, typename T2>
-struct PlusOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct PlusOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct MinusOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct MinusOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct MulOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct MulOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct MulStrLOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct MulStrLOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct MulStrROperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct MulStrROperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct DivOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct DivOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct ModOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct ModOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct LessOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct LessOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct LessEqOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct LessEqOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct GreaterOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct GreaterOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct GreaterEqOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct GreaterEqOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct EqualOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct EqualOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct EqualStrOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct EqualStrOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 template<typename T1, typename T2>
-struct NotEqualOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct NotEqualOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
-struct AndOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct AndOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
-struct OrOperation : MathOperation {
-	StackValue DoMath(StackValue op1, StackValue op2) const final;
+struct OrOperation {
+	static StackValue DoMath(const StackValue& op1, const StackValue& op2);
 };
 
 struct BoolCast : Operation {
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 };
 
 struct IntCast : Operation {
 	IntCast(int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
   private:
 	int pos_;
 	int line_;
@@ -263,6 +487,7 @@ struct IntCast : Operation {
 struct FloatCast : Operation {
 	FloatCast(int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
   private:
 	int pos_;
 	int line_;
@@ -270,25 +495,58 @@ struct FloatCast : Operation {
 
 struct StrCast : Operation {
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
 };
 
 struct Cast : Operation {
 	Cast(Lexeme::LexemeType cast_type, int pos, int line);
 	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
  private:
 	Lexeme::LexemeType cast_type_;
 	int pos_;
 	int line_;
 };
 
+// Prints the top count values to Stdout(), formatted like str() and
+// separated by spaces
 struct PrintOperation : Operation {
+	PrintOperation(std::size_t count = 1);
+
 	void Do(Context& context) const final;
-};
+	void Encode(Program& program) const final;
 
-using Operations = std::vector<std::shared_ptr<Operation>>;
+  private:
+	const std::size_t count_;
+};
 
 using OperationType = Lexeme::LexemeType;
 
-using BinaryKey = std::tuple<OperationType, ValueType, ValueType>;
+StackValue DoBinary(OperationType type, const StackValue& op1, const StackValue& op2, int pos, int line);
+
+// The kMathBinaries entry for the operand types; nullptr where the operation raises TypeError
+MathFunction FindMath(OperationType type, ValueType type1, ValueType type2);
+
+// A binary operation whose operand types were proven at compile time, named like
+// AddIntInt, LessRealInt or ConcatStrStr; skips the type dispatch of ExecuteOperation
+struct TypedExecuteOperation : Operation {
+	TypedExecuteOperation(OperationType type, ValueType type1, ValueType type2, int pos, int line);
+	void Do(Context& context) const final;
+	void Encode(Program& program) const final;
+
+	std::string Name() const;
+  private:
+	OperationType type_;
+	ValueType type1_;
+	ValueType type2_;
+	MathFunction math_;
+	int pos_;
+	int line_;
+};
+
+// Name() of the TypedExecuteOperation for the operation and operand types
+std::string TypedName(OperationType type, ValueType type1, ValueType type2);
+
+bool RangeContinues(Context& context, VariableSlot counter, VariableSlot bound, int pos, int line);
 
 } // namespace execution
\ No newline at end of file
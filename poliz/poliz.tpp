@@ -1,97 +1,76 @@
-#define NumOperation(op, opfunc)\
-{{op, Int, Int}, std::shared_ptr<MathOperation>(new opfunc<int, int>)},\
-{{op, Int, Real}, std::shared_ptr<MathOperation>(new opfunc<int, double>)},\
-{{op, Real, Int}, std::shared_ptr<MathOperation>(new opfunc<double, int>)},\
-{{op, Real, Real}, std::shared_ptr<MathOperation>(new opfunc<double, double>)},\
-{{op, Logic, Real}, std::shared_ptr<MathOperation>(new opfunc<bool, double>)},\
-{{op, Real, Logic}, std::shared_ptr<MathOperation>(new opfunc<double, bool>)},\
-{{op, Logic, Int}, std::shared_ptr<MathOperation>(new opfunc<bool, int>)},\
-{{op, Int, Logic}, std::shared_ptr<MathOperation>(new opfunc<int, bool>)},\
-{{op, Logic, Logic}, std::shared_ptr<MathOperation>(new opfunc<bool, bool>)},
+constexpr std::size_t kOperationTypes = Lexeme::Identifier + 1;
+constexpr std::size_t kValueTypes = Logic + 1;
 
-#define CompOperation(op, opfunc)\
-{{op, Int, Int}, std::shared_ptr<MathOperation>(new opfunc<int, int>)},\
-{{op, Int, Real}, std::shared_ptr<MathOperation>(new opfunc<int, double>)},\
-{{op, Real, Int}, std::shared_ptr<MathOperation>(new opfunc<double, int>)},\
-{{op, Real, Real}, std::shared_ptr<MathOperation>(new opfunc<double, double>)},\
-{{op, Logic, Real}, std::shared_ptr<MathOperation>(new opfunc<bool, double>)},\
-{{op, Real, Logic}, std::shared_ptr<MathOperation>(new opfunc<double, bool>)},\
-{{op, Logic, Int}, std::shared_ptr<MathOperation>(new opfunc<bool, int>)},\
-{{op, Int, Logic}, std::shared_ptr<MathOperation>(new opfunc<int, bool>)},\
-{{op, Logic, Logic}, std::shared_ptr<MathOperation>(new opfunc<bool, bool>)},\
-{{op, Str, Str}, std::shared_ptr<MathOperation>(new opfunc<std::string, std::string>)},
+using MathTable = std::array<MathFunction, kOperationTypes * kValueTypes * kValueTypes>;
 
-#define LogicOperation(op, opfunc)\
-{{op, Int, Int}, std::shared_ptr<MathOperation>(new opfunc<int, int>)},\
-{{op, Int, Real}, std::shared_ptr<MathOperation>(new opfunc<int, double>)},\
-{{op, Real, Int}, std::shared_ptr<MathOperation>(new opfunc<double, int>)},\
-{{op, Real, Real}, std::shared_ptr<MathOperation>(new opfunc<double, double>)},\
-{{op, Logic, Real}, std::shared_ptr<MathOperation>(new opfunc<bool, double>)},\
-{{op, Real, Logic}, std::shared_ptr<MathOperation>(new opfunc<double, bool>)},\
-{{op, Logic, Int}, std::shared_ptr<MathOperation>(new opfunc<bool, int>)},\
-{{op, Int, Logic}, std::shared_ptr<MathOperation>(new opfunc<int, bool>)},\
-{{op, Logic, Logic}, std::shared_ptr<MathOperation>(new opfunc<bool, bool>)},
+constexpr std::size_t MathIndex(OperationType op, ValueType type1, ValueType type2) {
+	return (static_cast<std::size_t>(op) * kValueTypes + type1) * kValueTypes + type2;
+}
 
-static const std::map<BinaryKey, std::shared_ptr<MathOperation>> kMathBinaries {
-	{{Lexeme::Or, Int, Int}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Int, Real}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Real, Int}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Real, Real}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Logic, Real}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Real, Logic}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Logic, Int}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Int, Logic}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Logic, Logic}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Str, Str}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Logic, Str}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Int, Str}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Real, Str}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Str, Logic}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Str, Real}, std::shared_ptr<MathOperation>(new OrOperation)},
-	{{Lexeme::Or, Str, Int}, std::shared_ptr<MathOperation>(new OrOperation)},
+template<template<typename, typename> class Op>
+constexpr void NumOperation(MathTable& table, OperationType op) {
+	table[MathIndex(op, Int, Int)] = &Op<int, int>::DoMath;
+	table[MathIndex(op, Int, Real)] = &Op<int, double>::DoMath;
+	table[MathIndex(op, Real, Int)] = &Op<double, int>::DoMath;
+	table[MathIndex(op, Real, Real)] = &Op<double, double>::DoMath;
+	table[MathIndex(op, Logic, Real)] = &Op<bool, double>::DoMath;
+	table[MathIndex(op, Real, Logic)] = &Op<double, bool>::DoMath;
+	table[MathIndex(op, Logic, Int)] = &Op<bool, int>::DoMath;
+	table[MathIndex(op, Int, Logic)] = &Op<int, bool>::DoMath;
+	table[MathIndex(op, Logic, Logic)] = &Op<bool, bool>::DoMath;
+}
 
-	{{Lexeme::And, Int, Int}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Int, Real}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Real, Int}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Real, Real}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Logic, Real}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Real, Logic}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Logic, Int}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Int, Logic}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Logic, Logic}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Str, Str}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Logic, Str}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Int, Str}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Real, Str}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Str, Logic}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Str, Real}, std::shared_ptr<MathOperation>(new AndOperation)},
-	{{Lexeme::And, Str, Int}, std::shared_ptr<MathOperation>(new AndOperation)},
+template<template<typename, typename> class Op>
+constexpr void CompOperation(MathTable& table, OperationType op) {
+	NumOperation<Op>(table, op);
+	table[MathIndex(op, Str, Str)] = &Op<std::string, std::string>::DoMath;
+}
 
-	{{Lexeme::Add, Str, Str}, std::shared_ptr<MathOperation>(new PlusOperation<std::string, std::string>)},
-	{{Lexeme::Mul, Str, Int}, std::shared_ptr<MathOperation>(new MulStrROperation<std::string, int>)},
-	{{Lexeme::Mul, Int, Str}, std::shared_ptr<MathOperation>(new MulStrLOperation<int, std::string>)},
+// Any pair of operands is accepted by and/or
+constexpr void LogicOperation(MathTable& table, OperationType op, MathFunction func) {
+	for (std::size_t type1 = 0; type1 < kValueTypes; ++type1) {
+		for (std::size_t type2 = 0; type2 < kValueTypes; ++type2) {
+			table[MathIndex(op, ValueType(type1), ValueType(type2))] = func;
+		}
+	}
+}
 
-	{{Lexeme::Equal, Str, Int}, std::shared_ptr<MathOperation>(new EqualStrOperation<std::string, int>)},
-	{{Lexeme::Equal, Int, Str}, std::shared_ptr<MathOperation>(new EqualStrOperation<int, std::string>)},
-	{{Lexeme::Equal, Str, Real}, std::shared_ptr<MathOperation>(new EqualStrOperation<std::string, double>)},
-	{{Lexeme::Equal, Real, Str}, std::shared_ptr<MathOperation>(new EqualStrOperation<double, std::string>)},
-	{{Lexeme::Equal, Str, Logic}, std::shared_ptr<MathOperation>(new EqualStrOperation<std::string, bool>)},
-	{{Lexeme::Equal, Logic, Str}, std::shared_ptr<MathOperation>(new EqualStrOperation<bool, std::string>)},
+// Unsupported combinations are left as nullptr, which is the error entry
+constexpr MathTable MakeMathBinaries() {
+	MathTable table{};
 
-	NumOperation(Lexeme::Add, PlusOperation)
-	NumOperation(Lexeme::Sub, MinusOperation)
-	NumOperation(Lexeme::Mul, MulOperation)
-	NumOperation(Lexeme::Div, DivOperation)
+	LogicOperation(table, Lexeme::Or, &OrOperation::DoMath);
+	LogicOperation(table, Lexeme::And, &AndOperation::DoMath);
 
-	{{Lexeme::Mod, Int, Int}, std::shared_ptr<MathOperation>(new ModOperation<int, int>)},
-	{{Lexeme::Mod, Logic, Int}, std::shared_ptr<MathOperation>(new ModOperation<bool, int>)},
-	{{Lexeme::Mod, Int, Logic}, std::shared_ptr<MathOperation>(new ModOperation<int, bool>)},
-	{{Lexeme::Mod, Logic, Logic}, std::shared_ptr<MathOperation>(new ModOperation<bool, bool>)},
+	table[MathIndex(Lexeme::Add, Str, Str)] = &PlusOperation<std::string, std::string>::DoMath;
+	table[MathIndex(Lexeme::Mul, Str, Int)] = &MulStrROperation<std::string, int>::DoMath;
+	table[MathIndex(Lexeme::Mul, Int, Str)] = &MulStrLOperation<int, std::string>::DoMath;
 
-	CompOperation(Lexeme::Less, LessOperation)
-	CompOperation(Lexeme::Greater, GreaterOperation)
-	CompOperation(Lexeme::LessEq, LessEqOperation)
-	CompOperation(Lexeme::GreaterEq, GreaterEqOperation)
-	CompOperation(Lexeme::Equal, EqualOperation)
-	CompOperation(Lexeme::NotEqual, NotEqualOperation)
-};
\ No newline at end of file
+	table[MathIndex(Lexeme::Equal, Str, Int)] = &EqualStrOperation<std::string, int>::DoMath;
+	table[MathIndex(Lexeme::Equal, Int, Str)] = &EqualStrOperation<int, std::string>::DoMath;
+	table[MathIndex(Lexeme::Equal, Str, Real)] = &EqualStrOperation<std::string, double>::DoMath;
+	table[MathIndex(Lexeme::Equal, Real, Str)] = &EqualStrOperation<double, std::string>::DoMath;
+	table[MathIndex(Lexeme::Equal, Str, Logic)] = &EqualStrOperation<std::string, bool>::DoMath;
+	table[MathIndex(Lexeme::Equal, Logic, Str)] = &EqualStrOperation<bool, std::string>::DoMath;
+
+	NumOperation<PlusOperation>(table, Lexeme::Add);
+	NumOperation<MinusOperation>(table, Lexeme::Sub);
+	NumOperation<MulOperation>(table, Lexeme::Mul);
+	NumOperation<DivOperation>(table, Lexeme::Div);
+
+	table[MathIndex(Lexeme::Mod, Int, Int)] = &ModOperation<int, int>::DoMath;
+	table[MathIndex(Lexeme::Mod, Logic, Int)] = &ModOperation<bool, int>::DoMath;
+	table[MathIndex(Lexeme::Mod, Int, Logic)] = &ModOperation<int, bool>::DoMath;
+	table[MathIndex(Lexeme::Mod, Logic, Logic)] = &ModOperation<bool, bool>::DoMath;
+
+	CompOperation<LessOperation>(table, Lexeme::Less);
+	CompOperation<GreaterOperation>(table, Lexeme::Greater);
+	CompOperation<LessEqOperation>(table, Lexeme::LessEq);
+	CompOperation<GreaterEqOperation>(table, Lexeme::GreaterEq);
+	CompOperation<EqualOperation>(table, Lexeme::Equal);
+	CompOperation<NotEqualOperation>(table, Lexeme::NotEqual);
+
+	return table;
+}
+
+static constexpr MathTable kMathBinaries = MakeMathBinaries();
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "profile.hpp"
+
+namespace execution {
+
+namespace {
+
+// Rows shown per section of the report
+const std::size_t kReportRows = 20;
+
+struct Row {
+	std::string name;
+	std::uint64_t count = 0;
+	std::uint64_t cost = 0;
+};
+
+// Jumps and stores carry no position, so they count for the closest line before
+// them, or after them at the start of the script
+int LineOf(const Program& program, OperationIndex index) {
+	for (OperationIndex i = index + 1; i-- > 0;) {
+		if (program.locations[i].line != 0) {
+			return program.locations[i].line;
+		}
+	}
+	for (OperationIndex i = index; i < program.locations.size(); ++i) {
+		if (program.locations[i].line != 0) {
+			return program.locations[i].line;
+		}
+	}
+	return 0;
+}
+
+void WriteSection(const std::string& column, std::vector<Row> rows, std::uint64_t total,
+					const std::string& unit, std::ostream& out) {
+	std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.cost > b.cost; });
+	char line[64];
+	if (unit.empty()) {
+		std::snprintf(line, sizeof(line), "%7s %12s  ", "%", "samples");
+	}
+	else {
+		std::snprintf(line, sizeof(line), "%14s %7s %12s  ", unit.c_str(), "%", "count");
+	}
+	out << line << column << "\n";
+	for (std::size_t i = 0; i < rows.size() && i < kReportRows; ++i) {
+		const Row& row = rows[i];
+		if (row.count == 0) {
+			break;
+		}
+		const double percent = total ? 100.0 * row.cost / total : 0.0;
+		if (unit.empty()) {
+			std::snprintf(line, sizeof(line), "%6.2f%% %12llu  ", percent, static_cast<unsigned long long>(row.count));
+		}
+		else {
+			std::snprintf(line, sizeof(line), "%14llu %6.2f%% %12llu  ", static_cast<unsigned long long>(row.cost),
+				percent, static_cast<unsigned long long>(row.count));
+		}
+		out << line << row.name << "\n";
+	}
+}
+
+} // namespace
+
+Profile::Profile(std::size_t operations, const std::string& unit):
+	counts_(operations, 0), costs_(operations, 0), unit_(unit) {}
+
+void Profile::WriteReport(const Program& program, std::ostream& out) const {
+	std::uint64_t total = 0;
+	std::uint64_t count = 0;
+	std::map<int, Row> lines;
+	std::map<std::string, Row> kinds;
+	std::vector<Row> operations;
+	for (OperationIndex index = 0; index < program.code.size(); ++index) {
+		total += Cost(index);
+		count += counts_[index];
+
+		const int line = LineOf(program, index);
+		Row& by_line = lines[line];
+		by_line.name = "line " + std::to_string(line);
+		by_line.count += counts_[index];
+		by_line.cost += Cost(index);
+
+		const std::string kind = Describe(program.code[index]);
+		Row& by_kind = kinds[kind];
+		by_kind.name = kind;
+		by_kind.count += counts_[index];
+		by_kind.cost += Cost(index);
+
+		const Location& location = program.locations[index];
+		operations.push_back({"#" + std::to_string(index) + " line " + std::to_string(line) + ":" +
+			std::to_string(location.pos) + " " + kind, counts_[index], Cost(index)});
+	}
+
+	auto values = [](const auto& rows) {
+		std::vector<Row> result;
+		for (const auto& row : rows) {
+			result.push_back(row.second);
+		}
+		return result;
+	};
+	if (unit_.empty()) {
+		out << "profile: " << count << " samples\n";
+	}
+	else {
+		out << "profile: " << total << " " << unit_ << " over " << count << " operations\n";
+	}
+	WriteSection("line", values(lines), total, unit_, out);
+	WriteSection("kind", values(kinds), total, unit_, out);
+	WriteSection("operation", operations, total, unit_, out);
+}
+
+void Profile::WriteCollapsed(const Program& program, const std::string& script, std::ostream& out) const {
+	std::map<std::pair<int, std::string>, std::uint64_t> stacks;
+	for (OperationIndex index = 0; index < program.code.size(); ++index) {
+		if (Cost(index) > 0) {
+			stacks[{LineOf(program, index), Describe(program.code[index])}] += Cost(index);
+		}
+	}
+	for (const auto& stack : stacks) {
+		out << script << ";line " << stack.first.first << ";" << stack.first.second << " " << stack.second << "\n";
+	}
+}
+
+} // namespace execution
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+
+namespace execution {
+
+// Execution counts and costs per operation index, reported per operation,
+// source line and operation kind
+class Profile {
+  public:
+	// The unit names what a cost is, such as "ns". Without one the profile only
+	// counts, as a sampler does, and ranks by the counts
+	Profile(std::size_t operations, const std::string& unit);
+
+	void Record(OperationIndex index, std::uint64_t cost) {
+		++counts_[index];
+		costs_[index] += cost;
+	}
+
+	// Lines, operation kinds and operations, most expensive first
+	void WriteReport(const Program& program, std::ostream& out) const;
+	// "script;line N;kind cost" lines that flamegraph.pl and speedscope read
+	void WriteCollapsed(const Program& program, const std::string& script, std::ostream& out) const;
+
+  private:
+	std::uint64_t Cost(OperationIndex index) const {
+		return unit_.empty() ? counts_[index] : costs_[index];
+	}
+
+	std::vector<std::uint64_t> counts_;
+	std::vector<std::uint64_t> costs_;
+	std::string unit_;
+};
+
+} // namespace execution
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+#include <sys/time.h>
+
+#include "../poliz/poliz.hpp"
+#include "profile.hpp"
+#include "sampler.hpp"
+
+namespace execution {
+
+namespace {
+
+const std::size_t kRingSize = 1 << 16;
+
+// Written by the signal handler only
+std::atomic<std::size_t> ring_head{0};
+// Written by the drain thread only
+std::atomic<std::size_t> ring_tail{0};
+OperationIndex ring[kRingSize];
+std::atomic<std::uint64_t> dropped{0};
+
+std::atomic<const Context*> sampled{nullptr};
+std::atomic<bool> stopping{false};
+struct sigaction previous_action;
+
+void OnSample(int) {
+	const Context* context = sampled.load(std::memory_order_relaxed);
+	if (!context) {
+		return;
+	}
+	const std::size_t head = ring_head.load(std::memory_order_relaxed);
+	if (head - ring_tail.load(std::memory_order_acquire) == kRingSize) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	// The handler runs on the interpreting thread, which stores the index of each
+	// operation before running it
+	ring[head % kRingSize] = context->current_index.load(std::memory_order_relaxed);
+	ring_head.store(head + 1, std::memory_order_release);
+}
+
+// Period in microseconds, 0 disarms
+void SetTimer(std::uint64_t period) {
+	itimerval timer{};
+	timer.it_interval.tv_sec = period / 1000000;
+	timer.it_interval.tv_usec = period % 1000000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+} // namespace
+
+Sampler::Sampler(const Context& context, int rate, Profile& profile): profile_(profile) {
+	ring_head = 0;
+	ring_tail = 0;
+	dropped = 0;
+	stopping = false;
+	sampled = &context;
+
+	struct sigaction action{};
+	action.sa_handler = OnSample;
+	// Interrupted output writes resume instead of failing with EINTR
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	if (sigaction(SIGPROF, &action, &previous_action) != 0) {
+		throw std::runtime_error("Error: cannot install the SIGPROF handler");
+	}
+
+	// The drain thread inherits the blocked mask, so samples always land on the interpreter
+	sigset_t profiling;
+	sigemptyset(&profiling);
+	sigaddset(&profiling, SIGPROF);
+	pthread_sigmask(SIG_BLOCK, &profiling, nullptr);
+	drainer_ = std::thread([this]() {
+		while (!stopping.load(std::memory_order_acquire)) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			Drain();
+		}
+	});
+	pthread_sigmask(SIG_UNBLOCK, &profiling, nullptr);
+
+	SetTimer(rate >= 1000000 ? 1 : 1000000 / rate);
+	running_ = true;
+}
+
+Sampler::~Sampler() {
+	Stop();
+}
+
+void Sampler::Stop() {
+	if (!running_) {
+		return;
+	}
+	running_ = false;
+	SetTimer(0);
+	sampled = nullptr;
+	stopping.store(true, std::memory_order_release);
+	drainer_.join();
+	sigaction(SIGPROF, &previous_action, nullptr);
+	Drain();
+}
+
+std::uint64_t Sampler::Dropped() const {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+void Sampler::Drain() {
+	const std::size_t head = ring_head.load(std::memory_order_acquire);
+	std::size_t tail = ring_tail.load(std::memory_order_relaxed);
+	for (; tail != head; ++tail) {
+		profile_.Record(ring[tail % kRingSize], 0);
+	}
+	ring_tail.store(tail, std::memory_order_release);
+}
+
+} // namespace execution
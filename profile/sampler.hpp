@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+
+#include "../poliz/poliz.hpp"
+#include "profile.hpp"
+
+namespace execution {
+
+// Records Context::current_index on SIGPROF, rate times a second of process CPU
+// time, and counts the samples per operation in a profile without a unit. The
+// kernel rounds the period up to its timer tick. The signal handler only appends
+// to a ring buffer; a thread with SIGPROF blocked drains it. One sampler runs at a time
+// Time in loops the JIT compiled goes to the instruction that entered them
+class Sampler {
+  public:
+	Sampler(const Context& context, int rate, Profile& profile);
+	~Sampler();
+
+	Sampler(const Sampler&) = delete;
+	Sampler& operator=(const Sampler&) = delete;
+
+	// Disarms the timer and drains the remaining samples
+	void Stop();
+
+	// Samples lost because the ring buffer was full
+	std::uint64_t Dropped() const;
+
+  private:
+	void Drain();
+
+	Profile& profile_;
+	std::thread drainer_;
+	bool running_ = false;
+};
+
+} // namespace execution
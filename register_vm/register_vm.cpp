@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+#include "register_vm.hpp"
+
+namespace execution {
+
+namespace {
+
+bool IsRegisterJump(RegisterOpcode opcode) {
+	switch (opcode) {
+		case RegisterOpcode::Jump:
+		case RegisterOpcode::JumpIfFalse:
+		case RegisterOpcode::BinaryJump:
+		case RegisterOpcode::RangeTest:
+		case RegisterOpcode::RangeNext:
+			return true;
+		default:
+			return false;
+	}
+}
+
+class RegisterCompiler {
+  public:
+	explicit RegisterCompiler(const Program& program);
+
+	RegisterProgram Compile();
+
+  private:
+	static const std::size_t kNone = std::numeric_limits<std::size_t>::max();
+	static const std::uint32_t kNoSlowPath = std::numeric_limits<std::uint32_t>::max();
+
+	const Program& program_;
+	RegisterProgram result_;
+	std::vector<int> depths_;
+	std::vector<bool> targets_;
+	std::vector<std::size_t> labels_;
+	// Registers that hold the operand stack entries at this point of the program
+	std::vector<std::uint32_t> stack_;
+	// Variables already checked for NameError in the current block
+	std::vector<bool> checked_;
+	std::uint32_t first_temp_;
+	std::uint32_t zero_;
+	// Instruction that wrote the temporary on top of the stack
+	std::size_t producer_ = kNone;
+	bool live_ = true;
+
+	std::uint32_t Temp(std::size_t depth) const;
+	bool IsTemp(std::uint32_t reg) const;
+
+	void Emit(const RegisterInstruction& instruction, const Location& location = {0, 0});
+	void Push(std::uint32_t reg);
+	void PushResult(RegisterInstruction instruction, const Location& location);
+	std::uint32_t Pop();
+	void Store(std::uint32_t slot, std::uint32_t value);
+	void Use(std::uint32_t slot, const Location& location, std::uint32_t slow_path = kNoSlowPath);
+
+	// Moves every stack entry into the temporary of its depth, as expected at jump targets
+	void Materialize();
+	void Reset(int depth);
+
+	void Translate(OperationIndex index);
+};
+
+RegisterCompiler::RegisterCompiler(const Program& program):
+	program_(program),
+	depths_(StackDepths(program)),
+	targets_(program.code.size() + 1, false),
+	labels_(program.code.size() + 1, 0),
+	checked_(program.variables.size(), false) {
+	for (const Instruction& instruction : program.code) {
+		if (IsJump(instruction.opcode)) {
+			targets_[instruction.operand] = true;
+		}
+	}
+	const int max_depth = *std::max_element(depths_.begin(), depths_.end());
+
+	first_temp_ = program.variables.size();
+	result_.first_constant = first_temp_ + std::max(max_depth, 0);
+	result_.constants = program.constants;
+	result_.constants.push_back(0);
+	zero_ = result_.first_constant + result_.constants.size() - 1;
+	result_.variables = program.variables;
+	result_.slow_paths = program.slow_paths;
+	result_.registers = result_.first_constant + result_.constants.size();
+}
+
+std::uint32_t RegisterCompiler::Temp(std::size_t depth) const {
+	return first_temp_ + depth;
+}
+
+bool RegisterCompiler::IsTemp(std::uint32_t reg) const {
+	return reg >= first_temp_ && reg < result_.first_constant;
+}
+
+void RegisterCompiler::Emit(const RegisterInstruction& instruction, const Location& location) {
+	result_.code.push_back(instruction);
+	result_.locations.push_back(location);
+	producer_ = kNone;
+}
+
+void RegisterCompiler::Push(std::uint32_t reg) {
+	if (IsTemp(reg) && reg != Temp(stack_.size())) {
+		Emit({RegisterOpcode::Move, 0, Temp(stack_.size()), reg});
+		reg = Temp(stack_.size());
+	}
+	stack_.push_back(reg);
+}
+
+void RegisterCompiler::PushResult(RegisterInstruction instruction, const Location& location) {
+	instruction.a = Temp(stack_.size());
+	Emit(instruction, location);
+	producer_ = result_.code.size() - 1;
+	stack_.push_back(instruction.a);
+}
+
+std::uint32_t RegisterCompiler::Pop() {
+	const std::uint32_t reg = stack_.back();
+	stack_.pop_back();
+	return reg;
+}
+
+void RegisterCompiler::Store(std::uint32_t slot, std::uint32_t value) {
+	// x = a + b writes x directly instead of going through a temporary
+	if (producer_ == result_.code.size() - 1 && value == Temp(stack_.size()) &&
+		result_.code.back().a == value) {
+		result_.code.back().a = slot;
+	}
+	else {
+		Emit({RegisterOpcode::Move, 0, slot, value});
+	}
+	checked_[slot] = true;
+}
+
+void RegisterCompiler::Use(std::uint32_t slot, const Location& location, std::uint32_t slow_path) {
+	if (!checked_[slot]) {
+		if (slow_path == kNoSlowPath) {
+			Emit({RegisterOpcode::Check, 0, slot}, location);
+		}
+		else {
+			Emit({RegisterOpcode::Check, 1, slot, 0, slow_path}, location);
+		}
+		checked_[slot] = true;
+	}
+}
+
+void RegisterCompiler::Materialize() {
+	for (std::size_t depth = 0; depth < stack_.size(); ++depth) {
+		if (stack_[depth] != Temp(depth)) {
+			Emit({RegisterOpcode::Move, 0, Temp(depth), stack_[depth]});
+			stack_[depth] = Temp(depth);
+		}
+	}
+}
+
+void RegisterCompiler::Reset(int depth) {
+	stack_.clear();
+	for (int i = 0; i < depth; ++i) {
+		stack_.push_back(Temp(i));
+	}
+	checked_.assign(checked_.size(), false);
+	producer_ = kNone;
+}
+
+void RegisterCompiler::Translate(OperationIndex index) {
+	const Instruction& instruction = program_.code[index];
+	const Location& location = program_.locations[index];
+	switch (instruction.opcode) {
+		case Opcode::PushConst:
+			Push(result_.first_constant + instruction.operand);
+			break;
+		case Opcode::Load:
+			Use(instruction.operand, location);
+			Push(instruction.operand);
+			break;
+		case Opcode::Store:
+			Store(instruction.operand, Pop());
+			break;
+		case Opcode::AddOne:
+			Emit({RegisterOpcode::AddOne, 0, instruction.operand, Pop()});
+			checked_[instruction.operand] = true;
+			break;
+		case Opcode::Go:
+			Materialize();
+			Emit({RegisterOpcode::Jump, 0, instruction.operand});
+			live_ = false;
+			break;
+		case Opcode::If: {
+			const std::uint32_t condition = Pop();
+			Materialize();
+			Emit({RegisterOpcode::JumpIfFalse, 0, instruction.operand, condition});
+			break;
+		}
+		case Opcode::Binary:
+		case Opcode::TypedBinary: {
+			const std::uint32_t op2 = Pop();
+			const std::uint32_t op1 = Pop();
+			PushResult({RegisterOpcode::Binary, instruction.aux, 0, op1, op2}, location);
+			break;
+		}
+		case Opcode::UnaryMinus:
+			PushResult({RegisterOpcode::Minus, 0, 0, Pop()}, location);
+			break;
+		case Opcode::Not:
+			PushResult({RegisterOpcode::Not, 0, 0, Pop()}, location);
+			break;
+		case Opcode::Cast:
+			PushResult({RegisterOpcode::Cast, instruction.aux, 0, Pop()}, location);
+			break;
+		case Opcode::Print: {
+			// The values are passed as consecutive temporaries
+			const std::size_t first = stack_.size() - instruction.operand;
+			for (std::size_t depth = first; depth < stack_.size(); ++depth) {
+				if (stack_[depth] != Temp(depth)) {
+					Emit({RegisterOpcode::Move, 0, Temp(depth), stack_[depth]});
+				}
+			}
+			stack_.resize(first);
+			Emit({RegisterOpcode::Print, 0, 0, Temp(first), instruction.operand}, location);
+			break;
+		}
+		case Opcode::GetRange: {
+			const std::uint32_t stop = Pop();
+			if (stack_.empty()) {
+				Emit({RegisterOpcode::Range, 1, 0, stop}, location);
+				Push(zero_);
+			}
+			else {
+				Emit({RegisterOpcode::Range, 2, 0, stack_.back(), stop}, location);
+			}
+			Push(stop);
+			break;
+		}
+		case Opcode::ExecuteVariables:
+			// The fused instruction keeps the locations of its loads for the NameError
+			Use(instruction.operand, location, instruction.operand3);
+			Use(instruction.operand2, location, instruction.operand3);
+			PushResult({RegisterOpcode::Binary, instruction.aux, 0, instruction.operand, instruction.operand2}, location);
+			break;
+		case Opcode::ExecuteIf: {
+			const std::uint32_t op2 = Pop();
+			const std::uint32_t op1 = Pop();
+			Materialize();
+			Emit({RegisterOpcode::BinaryJump, instruction.aux, instruction.operand, op1, op2}, location);
+			break;
+		}
+		case Opcode::ForRangeTest:
+			Materialize();
+			Emit({RegisterOpcode::RangeTest, 0, instruction.operand, instruction.operand2, instruction.operand3}, location);
+			break;
+		case Opcode::ForRangeNext:
+			Materialize();
+			Emit({RegisterOpcode::RangeNext, 0, instruction.operand, instruction.operand2, instruction.operand3}, location);
+			break;
+	}
+}
+
+RegisterProgram RegisterCompiler::Compile() {
+	const OperationIndex size = program_.code.size();
+	for (OperationIndex index = 0; index < size; ++index) {
+		if (depths_[index] < 0) {
+			labels_[index] = result_.code.size();
+			live_ = false;
+			continue;
+		}
+		if (targets_[index] || !live_) {
+			if (live_) {
+				Materialize();
+			}
+			Reset(depths_[index]);
+		}
+		labels_[index] = result_.code.size();
+		live_ = true;
+		Translate(index);
+	}
+	labels_[size] = result_.code.size();
+
+	for (RegisterInstruction& instruction : result_.code) {
+		if (IsRegisterJump(instruction.opcode)) {
+			instruction.a = labels_[instruction.a];
+		}
+	}
+	return std::move(result_);
+}
+
+// Runs a stack operation on register operands, for the instructions that are rarely hot
+void Escape(Context& context, const Operation& operation, const Variable* op1, const Variable* op2, Variable* result) {
+	if (op1) {
+		context.stack.emplace(op1->value);
+	}
+	if (op2) {
+		context.stack.emplace(op2->value);
+	}
+	operation.Do(context);
+	if (result) {
+		result->value = context.stack.top().Get();
+		result->defined = true;
+	}
+	while (!context.stack.empty()) {
+		context.stack.pop();
+	}
+}
+
+} // namespace
+
+RegisterProgram CompileRegisters(const Program& program) {
+	return RegisterCompiler(program).Compile();
+}
+
+void Run(const RegisterProgram& program, Context& context) {
+	std::vector<Variable>& registers = context.variables;
+	registers.resize(program.registers);
+	for (std::size_t i = 0; i < program.constants.size(); ++i) {
+		registers[program.first_constant + i].value = program.constants[i];
+		registers[program.first_constant + i].defined = true;
+	}
+
+	const RegisterInstruction* code = program.code.data();
+	const OperationIndex size = program.code.size();
+
+	while (context.operation_index < size) {
+		const OperationIndex index = context.operation_index++;
+		const RegisterInstruction& instruction = code[index];
+
+		switch (instruction.opcode) {
+			case RegisterOpcode::Move:
+				registers[instruction.a].value = registers[instruction.b].value;
+				registers[instruction.a].defined = true;
+				break;
+			case RegisterOpcode::Check:
+				if (!registers[instruction.a].defined) {
+					if (instruction.aux) {
+						program.slow_paths[instruction.c]->Do(context);
+					}
+					const Location& location = program.locations[index];
+					throw std::runtime_error("line " + std::to_string(location.line) + ":" +
+						std::to_string(location.pos) + ": NameError: name '" +
+						program.variables[instruction.a] + "' is not defined");
+				}
+				break;
+			case RegisterOpcode::Binary: {
+				const Location& location = program.locations[index];
+				const StackValue result = DoBinary(OperationType(instruction.aux),
+					&registers[instruction.b], &registers[instruction.c], location.pos, location.line);
+				registers[instruction.a].value = result.Get();
+				registers[instruction.a].defined = true;
+				break;
+			}
+			case RegisterOpcode::BinaryJump: {
+				const Location& location = program.locations[index];
+				const StackValue result = DoBinary(OperationType(instruction.aux),
+					&registers[instruction.b], &registers[instruction.c], location.pos, location.line);
+				if (!bool(result.Get())) {
+					context.operation_index = instruction.a;
+				}
+				break;
+			}
+			case RegisterOpcode::Not: {
+				const bool value = !bool(registers[instruction.b].value);
+				registers[instruction.a].value = value;
+				registers[instruction.a].defined = true;
+				break;
+			}
+			case RegisterOpcode::Minus: {
+				const Location& location = program.locations[index];
+				Escape(context, UnaryMinusOperation(location.pos, location.line),
+					&registers[instruction.b], nullptr, &registers[instruction.a]);
+				break;
+			}
+			case RegisterOpcode::Cast: {
+				if (instruction.aux == Lexeme::Bool) {
+					const bool value = bool(registers[instruction.b].value);
+					registers[instruction.a].value = value;
+					registers[instruction.a].defined = true;
+					break;
+				}
+				const Location& location = program.locations[index];
+				Escape(context, Cast(OperationType(instruction.aux), location.pos, location.line),
+					&registers[instruction.b], nullptr, &registers[instruction.a]);
+				break;
+			}
+			case RegisterOpcode::Print:
+				for (std::uint32_t i = 0; i < instruction.c; ++i) {
+					context.stack.emplace(registers[instruction.b + i].value);
+				}
+				PrintOperation(instruction.c).Do(context);
+				break;
+			case RegisterOpcode::Range: {
+				const Location& location = program.locations[index];
+				const Variable* start = instruction.aux == 2 ? &registers[instruction.b] : nullptr;
+				const Variable* stop = instruction.aux == 2 ? &registers[instruction.c] : &registers[instruction.b];
+				Escape(context, GetRangeOperation(location.pos, location.line), start, stop, nullptr);
+				break;
+			}
+			case RegisterOpcode::AddOne:
+				registers[instruction.a].value = int(registers[instruction.b].value) + 1;
+				registers[instruction.a].defined = true;
+				break;
+			case RegisterOpcode::Jump:
+				context.operation_index = instruction.a;
+				break;
+			case RegisterOpcode::JumpIfFalse:
+				if (!bool(registers[instruction.b].value)) {
+					context.operation_index = instruction.a;
+				}
+				break;
+			case RegisterOpcode::RangeTest: {
+				const Location& location = program.locations[index];
+				if (!RangeContinues(context, instruction.b, instruction.c, location.pos, location.line)) {
+					context.operation_index = instruction.a;
+				}
+				break;
+			}
+			case RegisterOpcode::RangeNext: {
+				Variable& counter = registers[instruction.b];
+				counter.value = int(counter.value) + 1;
+				const Location& location = program.locations[index];
+				if (RangeContinues(context, instruction.b, instruction.c, location.pos, location.line)) {
+					context.operation_index = instruction.a;
+				}
+				break;
+			}
+		}
+	}
+}
+
+} // namespace execution
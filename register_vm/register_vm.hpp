@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../poliz/poliz.hpp"
+#include "../bytecode/bytecode.hpp"
+
+namespace execution {
+
+// Three-address instructions; a is the destination or the jump target
+enum class RegisterOpcode : std::uint8_t {
+	Move,         // a = b
+	Check,        // NameError unless a is defined; reported by slow path c when aux is set
+	Binary,       // a = b <aux> c
+	BinaryJump,   // if not (b <aux> c) go a
+	Not,          // a = not b
+	Minus,        // a = -b
+	Cast,         // a = aux(b)
+	Print,        // print the c registers starting at b
+	Range,        // check the range bounds b (and c when aux is 2)
+	AddOne,       // a = int(b) + 1
+	Jump,         // go a
+	JumpIfFalse,  // if not b go a
+	RangeTest,    // if not (b < c) go a
+	RangeNext,    // b = int(b) + 1; if b < c go a
+};
+
+struct RegisterInstruction {
+	RegisterOpcode opcode;
+	std::uint8_t aux = 0;
+	std::uint32_t a = 0;
+	std::uint32_t b = 0;
+	std::uint32_t c = 0;
+};
+
+// The register file holds the variable slots, then one temporary per operand stack
+// depth, then the constants
+struct RegisterProgram {
+	std::vector<RegisterInstruction> code;
+	std::vector<Location> locations;
+	std::vector<PolymorphicValue> constants;
+	std::vector<VariableName> variables;
+	std::vector<const Operation*> slow_paths;
+	std::size_t first_constant = 0;
+	std::size_t registers = 0;
+};
+
+// Translates stack bytecode by simulating the operand stack at compile time
+RegisterProgram CompileRegisters(const Program& program);
+
+void Run(const RegisterProgram& program, Context& context);
+
+} // namespace execution
@@ -0,0 +1,23 @@
+# Int, float and bool arithmetic, literal and through variables whose type
+# changes, so the translation needs both its typed and its generic code
+a = 17
+b = 5
+print(a + b, a - b, a * b, a / b, a % b, -a / b, -a % b, a / -b, a % -b)
+print(2147483647 + 1, -2147483647 - 2, 65536 * 65536, 46341 * 46341)
+x = 7.5
+print(x + 1, x - 0.5, x * 2, x / 2, 1 / 4.0, 3 * 0.1, -x)
+print(True + True, True * 7, False - 1, -True, a + True)
+print(a < b, a <= 17, x > a, x >= 7.5, a == 17.0, b != 5, True == 1, 0.0 == False)
+print(2 + 3 * 4 - 6 / 2, (2 + 3) * (4 - 6) / 2, 10 - 4 - 3, 100 / 10 / 5)
+value = 1
+for i in range(8):
+    if i == 3:
+        value = value + 0.5
+    if i == 6:
+        value = True
+    value = value * 2 + i
+    print(i, value)
+total = 0
+for i in range(1, 200):
+    total = (total * 31 + i) % 1000003
+print(total)
@@ -0,0 +1,5 @@
+# exit: 136
+# The one int quotient that does not fit also traps
+low = -2147483647 - 1
+print(low)
+print(low / -1)
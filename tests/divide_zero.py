@@ -0,0 +1,5 @@
+# exit: 136
+# Int division by zero dies of SIGFPE once the output so far is written
+numerator = 10
+for i in range(5):
+    print(numerator / (3 - i))
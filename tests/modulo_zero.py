@@ -0,0 +1,5 @@
+# exit: 136
+# % 0 dies of SIGFPE too
+print(7 % 3, -7 % 3)
+zero = 0
+print(7 % zero)
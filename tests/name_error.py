@@ -0,0 +1,8 @@
+# exit: 1
+# A variable assigned only on the branch not taken raises NameError, after the
+# output so far is written
+flag = 0
+print("before")
+if flag:
+    late = 1
+print(late)
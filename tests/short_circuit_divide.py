@@ -0,0 +1,6 @@
+# exit: 136
+# Division by zero in a right operand that runs traps like anywhere else
+zero = 0
+print(True and 1, zero or "a")
+print(True and 1 / zero)
+print("not printed")
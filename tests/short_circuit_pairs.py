@@ -0,0 +1,27 @@
+# and/or on every pair of int, str, bool and float operands, literal and in
+# variables. Both give a bool, whatever the operands are
+
+zero = 0
+seven = 7
+empty = ""
+word = "ab"
+yes = True
+no = False
+fzero = 0.0
+real = 2.5
+print(0 and 0, 0 or 0, 0 and 7, 0 or 7, 0 and "", 0 or "", 0 and "ab", 0 or "ab", 0 and True, 0 or True, 0 and False, 0 or False, 0 and 0.0, 0 or 0.0, 0 and 2.5, 0 or 2.5)
+print(7 and 0, 7 or 0, 7 and 7, 7 or 7, 7 and "", 7 or "", 7 and "ab", 7 or "ab", 7 and True, 7 or True, 7 and False, 7 or False, 7 and 0.0, 7 or 0.0, 7 and 2.5, 7 or 2.5)
+print("" and 0, "" or 0, "" and 7, "" or 7, "" and "", "" or "", "" and "ab", "" or "ab", "" and True, "" or True, "" and False, "" or False, "" and 0.0, "" or 0.0, "" and 2.5, "" or 2.5)
+print("ab" and 0, "ab" or 0, "ab" and 7, "ab" or 7, "ab" and "", "ab" or "", "ab" and "ab", "ab" or "ab", "ab" and True, "ab" or True, "ab" and False, "ab" or False, "ab" and 0.0, "ab" or 0.0, "ab" and 2.5, "ab" or 2.5)
+print(True and 0, True or 0, True and 7, True or 7, True and "", True or "", True and "ab", True or "ab", True and True, True or True, True and False, True or False, True and 0.0, True or 0.0, True and 2.5, True or 2.5)
+print(False and 0, False or 0, False and 7, False or 7, False and "", False or "", False and "ab", False or "ab", False and True, False or True, False and False, False or False, False and 0.0, False or 0.0, False and 2.5, False or 2.5)
+print(0.0 and 0, 0.0 or 0, 0.0 and 7, 0.0 or 7, 0.0 and "", 0.0 or "", 0.0 and "ab", 0.0 or "ab", 0.0 and True, 0.0 or True, 0.0 and False, 0.0 or False, 0.0 and 0.0, 0.0 or 0.0, 0.0 and 2.5, 0.0 or 2.5)
+print(2.5 and 0, 2.5 or 0, 2.5 and 7, 2.5 or 7, 2.5 and "", 2.5 or "", 2.5 and "ab", 2.5 or "ab", 2.5 and True, 2.5 or True, 2.5 and False, 2.5 or False, 2.5 and 0.0, 2.5 or 0.0, 2.5 and 2.5, 2.5 or 2.5)
+print(zero and zero, zero or zero, zero and seven, zero or seven, zero and empty, zero or empty, zero and word, zero or word, zero and yes, zero or yes, zero and no, zero or no, zero and fzero, zero or fzero, zero and real, zero or real)
+print(seven and zero, seven or zero, seven and seven, seven or seven, seven and empty, seven or empty, seven and word, seven or word, seven and yes, seven or yes, seven and no, seven or no, seven and fzero, seven or fzero, seven and real, seven or real)
+print(empty and zero, empty or zero, empty and seven, empty or seven, empty and empty, empty or empty, empty and word, empty or word, empty and yes, empty or yes, empty and no, empty or no, empty and fzero, empty or fzero, empty and real, empty or real)
+print(word and zero, word or zero, word and seven, word or seven, word and empty, word or empty, word and word, word or word, word and yes, word or yes, word and no, word or no, word and fzero, word or fzero, word and real, word or real)
+print(yes and zero, yes or zero, yes and seven, yes or seven, yes and empty, yes or empty, yes and word, yes or word, yes and yes, yes or yes, yes and no, yes or no, yes and fzero, yes or fzero, yes and real, yes or real)
+print(no and zero, no or zero, no and seven, no or seven, no and empty, no or empty, no and word, no or word, no and yes, no or yes, no and no, no or no, no and fzero, no or fzero, no and real, no or real)
+print(fzero and zero, fzero or zero, fzero and seven, fzero or seven, fzero and empty, fzero or empty, fzero and word, fzero or word, fzero and yes, fzero or yes, fzero and no, fzero or no, fzero and fzero, fzero or fzero, fzero and real, fzero or real)
+print(real and zero, real or zero, real and seven, real or seven, real and empty, real or empty, real and word, real or word, real and yes, real or yes, real and no, real or no, real and fzero, real or fzero, real and real, real or real)
@@ -0,0 +1,5 @@
+# exit: 1
+# A right operand that does run still raises
+print(0 or 2, 7 and "")
+print(7 and "ab" + 1)
+print("not printed")
@@ -0,0 +1,24 @@
+# The result of and/or is a bool, so it takes part in arithmetic and
+# concatenation as True or False, never as one of its operands
+seven = 7
+word = "ab"
+real = 2.5
+print((seven and real) + 1, (0 or seven) * 3, (word and 0) - 1)
+print(str(0 or word) + "!", str(word and "") + "?")
+print(int(seven or 0), float(word and real), bool(0 or ""))
+print(0 or "" or real, seven and word and 0, 0 or False or "" or 0.0)
+print(not 0 and word, not (seven and word), 0 or 1 and "", (0 or 1) and "")
+print(1 < 2 and word, word == "ab" or 1 / 0 == 1, seven > 8 or real > 2)
+if seven and word:
+    print("both", seven, word)
+if 0 or "":
+    print("never")
+else:
+    print("neither")
+count = 0
+for i in range(6):
+    if i % 2 and i % 3:
+        count = count + 10
+    if i % 2 or i % 3:
+        count = count + 1
+print(count)
@@ -0,0 +1,13 @@
+# The right operand runs only when the left one does not decide the result, so
+# right operands that would raise are skipped
+zero = 0
+word = "ab"
+print(False and 1 / 0, True or 1 / 0, zero and 5 % zero, word or 5 % zero)
+print(0 and undefined, "ab" or undefined, "" and word + 1, 7 or word * word)
+print(zero and int("x1"), word or float("word"), False and 1 % zero, True or 1 % zero)
+print(zero and (1 / 0 or undefined), word or (word + 1 and 1 / 0))
+total = 0
+for i in range(4):
+    if i == 0 or 10 / i > 4:
+        total = total + i + 1
+print(total)
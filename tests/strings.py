@@ -0,0 +1,21 @@
+# Concatenation, repetition and comparison of strings, and casts between
+# strings and the other types
+word = "ab"
+empty = ""
+print(word + "cd", word * 3, 2 * word, word * 0 + "|", word * -2 + "|", empty + empty + "|")
+print(word < "b", word <= "ab", "b" > word, "abc" >= word, word == "ab", word != "ab", word == 1)
+print('it\'s', "say \"hi\"")
+print(str(42) + str(-7), str(2.5) + str(True), str(1 / 3.0), str(1e20), str(0.1 + 0.2))
+print(int("12") + 1, int(" -34 ") * 2, float("1.5") * 2, float("7"), int(3.99), int(-3.99))
+print(int(True), float(False), bool(""), bool("0"), bool(0.0), bool(-1), str(bool(word)))
+line = ""
+for i in range(5):
+    line = line + str(i) * i + ","
+print(line)
+text = "x"
+for i in range(4):
+    if i % 2 == 0:
+        text = text + "y"
+    else:
+        text = text * 2
+print(text)
@@ -0,0 +1,7 @@
+# exit: 1
+# A string meets an int once the variable changes type
+value = 3
+for i in range(3):
+    print(value + 1)
+    if i == 1:
+        value = "3"
@@ -0,0 +1,4 @@
+# exit: 1
+# Unary minus of a string
+word = "ab"
+print(-2, -word)
@@ -0,0 +1,4 @@
+# exit: 1
+# int() of a string that is not a number
+print(int("12"), float("2.5"))
+print(int("x12"))
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""Runs every script in bench/ through the interpreter and reports median times.
+
+Each script runs --runs times with --time, which splits a run into lex, parse,
+optimize and exec milliseconds. The medians go to a tab-separated results file
+with one row per script, so files from two versions can be diffed or passed
+back through --compare.
+
+    tools/bench.py ./python -O1
+    tools/bench.py --runs 9 --only if_chains ./python --engine=bytecode -O1
+    tools/bench.py --compare old.tsv --out new.tsv ./python -O1
+"""
+
+import argparse
+import os
+import statistics
+import subprocess
+import sys
+
+import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+PHASES = ["lex", "parse", "optimize", "exec"]
+
+
+def large_source(directory):
+    """A mixed ~4 MB script from tools/generate.py, for front-end throughput"""
+    path = os.path.join(directory, "large_source.py")
+    generate.write(path, "mixed", 4 << 20)
+    return path
+
+
+def scripts(args):
+    bench = os.path.join(ROOT, "bench")
+    result = [os.path.join(bench, name) for name in sorted(os.listdir(bench)) if name.endswith(".py")]
+    os.makedirs(args.work, exist_ok=True)
+    result.append(large_source(args.work))
+    if args.only:
+        result = [path for path in result if any(name in os.path.basename(path) for name in args.only)]
+    return result
+
+
+def measure(command, script, runs):
+    """Median milliseconds per phase, or an error message"""
+    samples = {phase: [] for phase in PHASES}
+    for _ in range(runs):
+        run = subprocess.run(command + ["--time", script], stdout=subprocess.DEVNULL,
+                             stderr=subprocess.PIPE, universal_newlines=True)
+        line = [line for line in run.stderr.splitlines() if line.startswith("time: ")]
+        if run.returncode != 0 or not line:
+            errors = run.stderr.strip().splitlines()
+            return "exit %d: %s" % (run.returncode, errors[-1] if errors else "no time line")
+        fields = line[-1].split()
+        for phase in PHASES:
+            samples[phase].append(float(fields[fields.index(phase) + 1]))
+    return {phase: statistics.median(values) for phase, values in samples.items()}
+
+
+def read_results(path):
+    results = {}
+    with open(path) as lines:
+        for line in lines:
+            fields = line.rstrip("\n").split("\t")
+            if line.startswith("#") or fields[0] == "script" or len(fields) < 3 + len(PHASES):
+                continue
+            results[fields[0]] = [float(value) for value in fields[3:3 + len(PHASES)]]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="interpreter and its flags")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--out", default="bench-results.tsv")
+    parser.add_argument("--work", default="_bench", help="directory for generated scripts")
+    parser.add_argument("--only", action="append", help="run scripts whose name contains this")
+    parser.add_argument("--compare", help="earlier results file to print ratios against")
+    args = parser.parse_args()
+    if not args.command:
+        parser.error("expected the interpreter command")
+
+    previous = read_results(args.compare) if args.compare else {}
+    flags = " ".join(args.command[1:]) or "-"
+    rows = []
+    print("%-22s %10s %10s %10s %12s" % ("script", "lex ms", "parse ms", "opt ms", "exec ms"))
+    for script in scripts(args):
+        name = os.path.basename(script)
+        times = measure(args.command, script, args.runs)
+        if isinstance(times, str):
+            print("%-22s %s" % (name, times))
+            rows.append([name, flags, str(args.runs)] + ["nan"] * len(PHASES))
+            continue
+        values = [times[phase] for phase in PHASES]
+        line = "%-22s %10.3f %10.3f %10.3f %12.3f" % tuple([name] + values)
+        if name in previous:
+            before = sum(previous[name])
+            line += "   x%.3f" % (sum(values) / before if before else float("nan"))
+        print(line)
+        sys.stdout.flush()
+        rows.append([name, flags, str(args.runs)] + ["%.3f" % value for value in values])
+
+    with open(args.out, "w") as out:
+        out.write("\t".join(["script", "flags", "runs"] + [phase + "_ms" for phase in PHASES]) + "\n")
+        for row in rows:
+            out.write("\t".join(row) + "\n")
+    print("results in %s" % args.out)
+
+
+if __name__ == "__main__":
+    main()
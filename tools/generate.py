@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Generates valid SubPython scripts of a given size and shape.
+
+Shapes:
+    flat         long list of assignments, short ifs and the odd print
+    nested       if/else blocks nested --depth levels deep, over and over
+    expressions  assignments whose right side has --terms operands
+    identifiers  every assignment introduces a new variable name
+    branches     every if tests and assigns a new variable name, so blocks and
+                 names grow together
+    text         comment blocks and string literals
+    mixed        all of the above in turn
+
+The scripts only use small non-negative ints, so every engine runs them without
+overflow and prints what Python prints.
+
+    tools/generate.py --shape nested --size 64M -o _bench/nested.py
+"""
+
+import argparse
+import random
+import sys
+
+SHAPES = ["flat", "nested", "expressions", "identifiers", "branches", "text", "mixed"]
+# Names the flat and expression shapes read and write
+POOL = 100
+WORDS = ["lexer", "scans", "the", "source", "once", "and", "hands", "every", "lexeme", "to", "parser",
+         "while", "comments", "strings", "indentation", "take", "most", "bytes"]
+
+
+def parse_size(text):
+    """Bytes from a count with an optional K, M or G suffix"""
+    units = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}
+    if text[-1:].upper() in units:
+        return int(float(text[:-1]) * units[text[-1].upper()])
+    return int(text)
+
+
+class Generator:
+    def __init__(self, depth=32, terms=200, seed=1):
+        self.depth = depth
+        self.terms = terms
+        self.random = random.Random(seed)
+        self.statements = 0
+        self.names = 0
+        self.last = "p0"
+
+    def prologue(self):
+        return "".join("p%d = %d\n" % (i, i % 10) for i in range(POOL))
+
+    def pool(self):
+        return "p%d" % self.random.randrange(POOL)
+
+    def flat(self):
+        self.statements += 4
+        target = self.pool()
+        lines = [
+            "%s = (%s + %d) %% 97\n" % (target, self.pool(), self.random.randrange(1000)),
+            "if %s > %d and %s != 3:\n" % (target, self.random.randrange(97), self.pool()),
+            "    %s = %s %% 13 + 2\n" % (self.pool(), target),
+            "else:\n    %s = %s\n" % (self.pool(), target),
+        ]
+        if self.statements % 4000 == 0:
+            lines.append('print("flat", %s, %s)\n' % (target, self.pool()))
+        return "".join(lines)
+
+    def nested(self):
+        lines = []
+        for level in range(self.depth):
+            indent = "    " * level
+            lines.append("%sif p%d >= %d:\n" % (indent, level % POOL, -level))
+            lines.append("%s    p%d = (p%d + %d) %% 50\n" % (indent, level % POOL, (level + 1) % POOL, level))
+        for level in reversed(range(self.depth)):
+            indent = "    " * level
+            lines.append("%selse:\n%s    p%d = %d\n" % (indent, indent, level % POOL, level % 10))
+        self.statements += 2 * self.depth
+        lines.append('print("nested", p0, p%d)\n' % ((self.depth - 1) % POOL))
+        return "".join(lines)
+
+    def expressions(self):
+        parts = [self.pool()]
+        for _ in range(self.terms - 1):
+            parts.append(self.random.choice([" + ", " - "]))
+            # Pool values stay below 100, so the products and sums never overflow
+            if self.random.randrange(4) == 0:
+                parts.append("(%s %% 5) * (%s %% 7)" % (self.pool(), self.pool()))
+            else:
+                parts.append(self.pool())
+        self.statements += 2
+        target = self.pool()
+        # The offset keeps the sum positive, where % means the same as in Python
+        return "%s = (%s + %d) %% 97\nprint(\"expressions\", %s)\n" % (
+            target, "".join(parts), 100 * self.terms, target)
+
+    def identifiers(self):
+        lines = []
+        for _ in range(64):
+            name = "name_%d_%s" % (self.names, "abcdefghij"[self.names % 10] * (1 + self.names % 7))
+            source = self.pool() if self.names % 64 == 0 else self.last
+            lines.append("%s = (%s + %d) %% 89\n" % (name, source, self.names % 10))
+            self.last = name
+            self.names += 1
+        self.statements += 64
+        lines.append('print("identifiers", %s)\n' % self.last)
+        return "".join(lines)
+
+    def branches(self):
+        lines = []
+        for _ in range(16):
+            name = "branch_%d" % self.names
+            lines.append("%s = (%s + %d) %% 89\nif %s > 44:\n    %s = %s %% 13\n" % (
+                name, self.pool(), self.names % 10, name, name, name))
+            self.names += 1
+        self.statements += 48
+        lines.append('print("branches", %s)\n' % name)
+        return "".join(lines)
+
+    def text(self):
+        lines = ["# %s\n" % " ".join(self.random.choice(WORDS) for _ in range(12)) for _ in range(4)]
+        name = "t%d" % self.random.randrange(10)
+        lines.append('%s = "%s"\n' % (name, " ".join(self.random.choice(WORDS) for _ in range(10))))
+        lines.append("%s = %s + ' and \\'%s\\''\n" % (name, name, self.random.choice(WORDS)))
+        self.statements += 2
+        if self.statements % 100 == 0:
+            lines.append("print(%s)\n" % name)
+        return "".join(lines)
+
+    def chunk(self, shape):
+        if shape == "mixed":
+            shape = SHAPES[self.statements // 7 % (len(SHAPES) - 1)]
+        return getattr(self, shape)()
+
+
+def write(path, shape, size, depth=32, terms=200, seed=1):
+    """Writes a script of about size bytes and returns its exact size"""
+    generator = Generator(depth, terms, seed)
+    written = 0
+    with open(path, "w") as out:
+        header = "# Generated by tools/generate.py: %s, %d bytes\n" % (shape, size) + generator.prologue()
+        out.write(header)
+        written += len(header)
+        buffer = []
+        buffered = 0
+        while written + buffered < size:
+            text = generator.chunk(shape)
+            buffer.append(text)
+            buffered += len(text)
+            if buffered > 1 << 20:
+                out.write("".join(buffer))
+                written += buffered
+                buffer = []
+                buffered = 0
+        out.write("".join(buffer))
+        written += buffered
+    return written
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--shape", choices=SHAPES, default="mixed")
+    parser.add_argument("--size", default="1M", help="bytes, with an optional K, M or G suffix")
+    parser.add_argument("--depth", type=int, default=32, help="nesting depth of the nested shape")
+    parser.add_argument("--terms", type=int, default=200, help="operands per expression")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+    size = write(args.output, args.shape, parse_size(args.size), args.depth, args.terms, args.seed)
+    sys.stderr.write("%s: %d bytes\n" % (args.output, size))
+
+
+if __name__ == "__main__":
+    main()
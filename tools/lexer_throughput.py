@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Lexer throughput in MB/s for every scanning kernel on generated scripts.
+
+Generates one script per shape with tools/generate.py and runs the interpreter
+on it with --time and each of --lexer=scalar, sse2 and avx2, keeping the fastest
+of --runs lexer passes. Kernels the CPU cannot run are left out. The rows go
+to a tab-separated file as well.
+
+    tools/lexer_throughput.py ./python
+    tools/lexer_throughput.py --size 64M --shape text --runs 5 ./python
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+import generate
+
+KERNELS = ["scalar", "sse2", "avx2"]
+
+
+def lex_ms(command, kernel, script):
+    """Milliseconds of the lexer pass, or None when the kernel does not run here"""
+    run = subprocess.run(command + ["--lexer=" + kernel, "--time", script], stdout=subprocess.DEVNULL,
+                         stderr=subprocess.PIPE, universal_newlines=True)
+    line = [line for line in run.stderr.splitlines() if line.startswith("time: ")]
+    if run.returncode != 0 or not line:
+        return None
+    fields = line[-1].split()
+    return float(fields[fields.index("lex") + 1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="interpreter and its flags")
+    parser.add_argument("--shape", action="append", choices=generate.SHAPES, help="all shapes by default")
+    parser.add_argument("--size", default="16M")
+    parser.add_argument("--runs", type=int, default=3)
+    parser.add_argument("--work", default="_bench", help="directory for generated scripts")
+    parser.add_argument("--out", default="lexer-results.tsv")
+    args = parser.parse_args()
+    if not args.command:
+        parser.error("expected the interpreter command")
+
+    os.makedirs(args.work, exist_ok=True)
+    rows = []
+    print("%-12s %8s" % ("shape", "MB") + "".join("%12s" % (kernel + " MB/s") for kernel in KERNELS))
+    for shape in args.shape or generate.SHAPES:
+        script = os.path.join(args.work, "lexer_%s.py" % shape)
+        megabytes = generate.write(script, shape, generate.parse_size(args.size)) / float(1 << 20)
+        line = "%-12s %8.1f" % (shape, megabytes)
+        for kernel in KERNELS:
+            times = [lex_ms(args.command, kernel, script) for _ in range(args.runs)]
+            if None in times:
+                line += "%12s" % "-"
+                continue
+            throughput = megabytes / min(times) * 1000
+            line += "%12.1f" % throughput
+            rows.append([shape, kernel, "%.3f" % megabytes, "%.3f" % min(times), "%.1f" % throughput])
+        os.remove(script)
+        print(line)
+        sys.stdout.flush()
+
+    with open(args.out, "w") as out:
+        out.write("\t".join(["shape", "kernel", "mb", "lex_ms", "mb_per_s"]) + "\n")
+        for row in rows:
+            out.write("\t".join(row) + "\n")
+    print("results in %s" % args.out)
+
+
+if __name__ == "__main__":
+    main()
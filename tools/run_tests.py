@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Runs the scripts in tests/ and compares what they do with what they should.
+
+Every tests/NAME.py comes with NAME.out, its standard output, and NAME.err, its
+standard error, when it writes any. A "# exit: N" line at the top gives an exit
+status other than 0, 128 plus the signal number for a signal. Each script runs
+on every engine at -O0 and -O1.
+
+With --emit-cpp each script is translated to C++ at -O0 and -O1 instead, built
+the way make native builds it and run. Its output, error output and exit status
+have to be the interpreter's.
+
+    tools/run_tests.py ./python
+    tools/run_tests.py --engine register ./python
+    tools/run_tests.py --emit-cpp --cxx g++ ./python
+"""
+
+import argparse
+import difflib
+import glob
+import os
+import re
+import subprocess
+import sys
+
+ENGINES = ["poliz", "bytecode", "register"]
+LEVELS = ["-O0", "-O1"]
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+# What a translated script links against besides aot/runtime.hpp
+RUNTIME = ["output/output.cpp", "format/format.cpp"]
+
+
+def execute(command):
+    """Standard output, standard error and the exit status as a shell reports it"""
+    run = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True,
+                         timeout=60)
+    return run.stdout, run.stderr, 128 - run.returncode if run.returncode < 0 else run.returncode
+
+
+def expected(script):
+    base = script[:-len(".py")]
+    with open(script) as source:
+        header = re.search(r"^# exit: (\d+)$", source.read(), re.MULTILINE)
+    streams = []
+    for suffix in [".out", ".err"]:
+        if os.path.exists(base + suffix):
+            with open(base + suffix) as stream:
+                streams.append(stream.read())
+        else:
+            streams.append("")
+    return streams[0], streams[1], int(header.group(1)) if header else 0
+
+
+def build_runtime(cxx, work):
+    """Object files of RUNTIME, compiled once for every translated script"""
+    objects = []
+    for source in RUNTIME:
+        target = os.path.join(work, os.path.basename(source)[:-len(".cpp")] + ".o")
+        subprocess.run(cxx + ["-c", source, "-o", target], cwd=ROOT, check=True)
+        objects.append(target)
+    return objects
+
+
+def translate(command, cxx, objects, script, level, work):
+    """The translated script's run as execute gives it, or a message on why there is none"""
+    base = os.path.join(work, os.path.basename(script)[:-len(".py")] + level.replace("-", "_"))
+    code, errors, status = execute(command + ["--emit-cpp", level, script])
+    if status != 0:
+        return "--emit-cpp failed: " + errors.strip()
+    with open(base + ".cpp", "w") as out:
+        out.write(code)
+    build = subprocess.run(cxx + [base + ".cpp"] + objects + ["-o", base], cwd=ROOT, stdout=subprocess.PIPE,
+                           stderr=subprocess.STDOUT, universal_newlines=True)
+    if build.returncode != 0:
+        return "build failed:\n" + "\n".join(build.stdout.splitlines()[:20])
+    return execute([base])
+
+
+def compare(name, got, want):
+    """Lines telling how got differs from want, none when they are the same"""
+    problems = []
+    for stream, got_text, want_text in zip(["stdout", "stderr"], got, want):
+        if got_text != want_text:
+            problems.append("%s differs:" % stream)
+            problems.extend(line.rstrip("\n") for line in difflib.unified_diff(
+                want_text.splitlines(True), got_text.splitlines(True), "expected", name, n=1))
+    if got[2] != want[2]:
+        problems.append("exit status %d, expected %d" % (got[2], want[2]))
+    return problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="interpreter and its flags")
+    parser.add_argument("--engine", action="append", choices=ENGINES, help="all engines by default")
+    parser.add_argument("--tests", default=os.path.join(ROOT, "tests"))
+    parser.add_argument("--emit-cpp", action="store_true", help="check the C++ translation instead")
+    parser.add_argument("--cxx", default="clang++", help="compiler for --emit-cpp")
+    parser.add_argument("--work", default="_tests", help="directory for translated scripts")
+    args = parser.parse_args()
+    if not args.command:
+        parser.error("expected the interpreter command")
+    command = [os.path.abspath(args.command[0])] + args.command[1:]
+    if args.emit_cpp:
+        work = os.path.abspath(args.work)
+        os.makedirs(work, exist_ok=True)
+        cxx = args.cxx.split() + ["-O2", "-std=c++17", "-I."]
+        objects = build_runtime(cxx, work)
+
+    scripts = sorted(glob.glob(os.path.join(args.tests, "*.py")))
+    runs = 0
+    failures = 0
+    if args.emit_cpp:
+        cases = [["--emit-cpp", level] for level in LEVELS]
+    else:
+        cases = [["--engine=" + engine, level] for engine in args.engine or ENGINES for level in LEVELS]
+    for script in scripts:
+        name = os.path.basename(script)
+        want = expected(script)
+        for flags in cases:
+            runs += 1
+            if args.emit_cpp:
+                got = translate(command, cxx, objects, script, flags[1], work)
+                problems = [got] if isinstance(got, str) else compare(
+                    name, got, execute(command + [flags[1], script]))
+            else:
+                problems = compare(name, execute(command + flags + [script]), want)
+            if problems:
+                failures += 1
+                print("FAIL %s %s" % (name, " ".join(flags)))
+                print("\n".join("    " + line for problem in problems for line in problem.splitlines()))
+                sys.stdout.flush()
+    print("%d of %d runs passed, %d scripts" % (runs - failures, runs, len(scripts)))
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Front-end time and peak memory of the interpreter against input size.
+
+Generates scripts with tools/generate.py at sizes doubling from --min to --max
+and runs each once with --time. Every row shows the lex, parse and exec
+milliseconds, the front-end throughput and the peak resident memory. Cost per
+megabyte that grows across the rows points at super-linear behavior. The rows
+go to a tab-separated file, and to a chart with --plot when matplotlib is around.
+
+    tools/scaling.py ./python
+    tools/scaling.py --shape nested --max 1G --plot scaling.png ./python -O1
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+import generate
+
+PHASES = ["lex", "parse", "optimize", "exec"]
+# Cost per megabyte this far above the smallest input's is flagged
+SUPERLINEAR = 1.5
+
+
+def run(command, script):
+    """Milliseconds per phase and peak resident megabytes, or an error message"""
+    process = subprocess.Popen(command + ["--time", script], stdout=subprocess.DEVNULL,
+                               stderr=subprocess.PIPE, universal_newlines=True)
+    stderr = process.stderr.read()
+    _, status, usage = os.wait4(process.pid, 0)
+    status = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+    process.returncode = status
+    line = [line for line in stderr.splitlines() if line.startswith("time: ")]
+    if status != 0 or not line:
+        errors = stderr.strip().splitlines()
+        return "status %d: %s" % (status, errors[-1] if errors else "no time line")
+    fields = line[-1].split()
+    times = {phase: float(fields[fields.index(phase) + 1]) for phase in PHASES}
+    # ru_maxrss is in kilobytes on Linux
+    times["peak"] = usage.ru_maxrss / 1024.0
+    return times
+
+
+def sizes(low, high):
+    size = low
+    while size <= high:
+        yield size
+        size *= 2
+
+
+def plot(rows, path):
+    try:
+        import matplotlib
+        matplotlib.use("Agg")
+        import matplotlib.pyplot as pyplot
+    except ImportError:
+        sys.stderr.write("matplotlib is not installed, no plot\n")
+        return
+    figure, (time_axis, memory_axis) = pyplot.subplots(1, 2, figsize=(11, 4))
+    for shape in sorted(set(row["shape"] for row in rows)):
+        points = [row for row in rows if row["shape"] == shape]
+        megabytes = [row["mb"] for row in points]
+        time_axis.loglog(megabytes, [row["lex"] + row["parse"] for row in points], "o-", label=shape)
+        memory_axis.loglog(megabytes, [row["peak"] for row in points], "o-", label=shape)
+    time_axis.set(xlabel="input MB", ylabel="lex + parse ms", title="front-end time")
+    memory_axis.set(xlabel="input MB", ylabel="peak RSS MB", title="peak memory")
+    time_axis.legend()
+    figure.tight_layout()
+    figure.savefig(path)
+    print("plot in %s" % path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="interpreter and its flags")
+    parser.add_argument("--shape", action="append", choices=generate.SHAPES,
+                        help="script shapes to measure, mixed by default")
+    parser.add_argument("--min", default="1M")
+    parser.add_argument("--max", default="64M")
+    parser.add_argument("--work", default="_bench", help="directory for generated scripts")
+    parser.add_argument("--keep", action="store_true", help="keep the generated scripts")
+    parser.add_argument("--out", default="scaling-results.tsv")
+    parser.add_argument("--plot", help="chart of time and memory against size, needs matplotlib")
+    args = parser.parse_args()
+    if not args.command:
+        parser.error("expected the interpreter command")
+
+    os.makedirs(args.work, exist_ok=True)
+    rows = []
+    print("%-12s %8s %10s %10s %10s %10s %10s %10s" % (
+        "shape", "MB", "lex ms", "parse ms", "exec ms", "front MB/s", "peak MB", "ms/MB"))
+    for shape in args.shape or ["mixed"]:
+        first = None
+        for size in sizes(generate.parse_size(args.min), generate.parse_size(args.max)):
+            script = os.path.join(args.work, "scale_%s_%d.py" % (shape, size))
+            actual = generate.write(script, shape, size)
+            times = run(args.command, script)
+            if not args.keep:
+                os.remove(script)
+            megabytes = actual / float(1 << 20)
+            if isinstance(times, str):
+                print("%-12s %8.1f %s" % (shape, megabytes, times))
+                break
+            front = times["lex"] + times["parse"]
+            per_megabyte = front / megabytes
+            first = first or per_megabyte
+            print("%-12s %8.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.2f%s" % (
+                shape, megabytes, times["lex"], times["parse"], times["exec"],
+                megabytes / front * 1000 if front else float("inf"), times["peak"], per_megabyte,
+                "   super-linear" if per_megabyte > SUPERLINEAR * first else ""))
+            sys.stdout.flush()
+            times.update(shape=shape, mb=megabytes)
+            rows.append(times)
+
+    with open(args.out, "w") as out:
+        out.write("\t".join(["shape", "mb"] + [phase + "_ms" for phase in PHASES] + ["peak_mb"]) + "\n")
+        for row in rows:
+            out.write("\t".join([row["shape"], "%.3f" % row["mb"]] +
+                                ["%.3f" % row[key] for key in PHASES + ["peak"]]) + "\n")
+    print("results in %s" % args.out)
+    if args.plot:
+        plot(rows, args.plot)
+
+
+if __name__ == "__main__":
+    main()